@@ -0,0 +1,66 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// helpers shared by the buzz-bench subcommands
+namespace bench
+{
+    using Clock = std::chrono::steady_clock;
+
+    inline double ms_since(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // mean ms per call of f over n calls
+    template <typename F>
+    double time_ms(int n, F &&f)
+    {
+        auto start = Clock::now();
+        for (int i = 0; i < n; ++i)
+            f();
+        return ms_since(start) / n;
+    }
+
+    // heap allocations so far (buzz-bench replaces operator new to count them)
+    std::size_t allocations();
+
+    // read syscalls this process made so far (syscr in /proc/self/io)
+    inline long read_syscalls()
+    {
+        std::FILE *f = std::fopen("/proc/self/io", "r");
+        if (!f)
+            return -1;
+        char key[32];
+        long value = 0, syscr = -1;
+        while (std::fscanf(f, "%31s %ld", key, &value) == 2)
+            if (std::string(key) == "syscr:")
+                syscr = value;
+        std::fclose(f);
+        return syscr;
+    }
+
+    // argv[i] as a positive int, or fallback when missing or not a number
+    inline int arg(int argc, char **argv, int i, int fallback)
+    {
+        if (i >= argc)
+            return fallback;
+        char *end = nullptr;
+        long v = std::strtol(argv[i], &end, 10);
+        return (end != argv[i] && *end == '\0' && v > 0 && v < 1000000000) ? static_cast<int>(v) : fallback;
+    }
+
+    // keeps the optimizer from dropping a result
+    template <typename T>
+    void keep(const T &value)
+    {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+}
+
+#endif
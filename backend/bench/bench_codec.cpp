@@ -0,0 +1,91 @@
+// user-024: the history codec on synthetic 1 s recordings of 1k, 5k and 20k
+// processes: bytes per sample against a binary snapshot, encode and decode
+// throughput, and a roundtrip check
+#include <random>
+#include <string>
+#include <vector>
+
+#include <codec.hpp>
+#include <sampler.hpp>
+#include <snapshot.hpp>
+#include <snapshot_binary.hpp>
+
+#include "bench.hpp"
+#include "synthetic.hpp"
+
+int bench_codec(int argc, char **argv)
+{
+    int key_every = bench::arg(argc, argv, 1, 60);
+
+    Sampler sampler;
+    sampler.tick();
+    SystemSample base = sampler.tick();
+    std::mt19937 rng(42);
+
+    std::printf("keyframe every %d frames; sizes in bytes per sample\n", key_every);
+    std::printf("  %6s %6s | %8s | %8s %9s %8s %6s | %14s %14s | %s\n", "procs", "frames", "binary", "codec", "keyframe",
+                "delta", "ratio", "encode", "decode", "roundtrip");
+    for (int n : {1000, 5000, 20000})
+    {
+        std::vector<SystemSample> frames = bench::synthetic_recording(base, n, n >= 20000 ? 180 : 600, rng);
+        double rows = 0.0;
+        for (const SystemSample &s : frames)
+            rows += static_cast<double>(s.processes().size());
+
+        codec::Encoder encoder;
+        std::vector<std::string> encoded(frames.size());
+        auto start = bench::Clock::now();
+        for (size_t i = 0; i < frames.size(); ++i)
+            encoder.encode(frames[i], i % static_cast<size_t>(key_every) == 0, encoded[i]);
+        double encode_ms = bench::ms_since(start);
+
+        double key_bytes = 0.0, delta_bytes = 0.0;
+        size_t keys = 0;
+        for (const std::string &frame : encoded)
+        {
+            if (codec::is_keyframe(frame.data(), frame.size()))
+            {
+                key_bytes += static_cast<double>(frame.size());
+                ++keys;
+            }
+            else
+            {
+                delta_bytes += static_cast<double>(frame.size());
+            }
+        }
+
+        // decode into one reused sample, as replay does
+        codec::Decoder decoder;
+        SystemSample decoded;
+        std::string err;
+        size_t failed = 0;
+        start = bench::Clock::now();
+        for (const std::string &frame : encoded)
+            failed += decoder.decode(frame.data(), frame.size(), decoded, &err) ? 0 : 1;
+        double decode_ms = bench::ms_since(start);
+
+        // every frame is decoded again, every tenth compared whole through to_json,
+        // which costs far more than the decode
+        codec::Decoder check;
+        size_t mismatches = failed, compared = 0;
+        for (size_t i = 0; i < frames.size() && failed == 0; ++i)
+        {
+            if (!check.decode(encoded[i].data(), encoded[i].size(), decoded, &err))
+                ++mismatches;
+            else if (i % 10 == 9 && ++compared && snapshot::to_json(decoded) != snapshot::to_json(frames[i]))
+                ++mismatches;
+        }
+
+        snapshot::BinaryImage image;
+        image.encode(frames.back());
+        double count = static_cast<double>(frames.size());
+        double avg = (key_bytes + delta_bytes) / count;
+        std::printf("  %6d %6zu | %8zu | %8.0f %9.0f %8.0f %5.1fx | %5.2f ms %4.1fM/s %5.2f ms %4.1fM/s | %zu of %zu bad%s%s\n", n,
+                    frames.size(), image.size(), avg, keys ? key_bytes / static_cast<double>(keys) : 0.0,
+                    frames.size() > keys ? delta_bytes / (count - static_cast<double>(keys)) : 0.0,
+                    static_cast<double>(image.size()) / avg, encode_ms / count, rows / encode_ms / 1000.0, decode_ms / count,
+                    rows / decode_ms / 1000.0, mismatches, compared, err.empty() ? "" : ", ", err.c_str());
+    }
+    std::printf("  encode/decode: ms per sample and process rows per second\n");
+    return 0;
+}
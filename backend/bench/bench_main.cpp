@@ -0,0 +1,95 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include "bench.hpp"
+
+// count every heap allocation in the process, for benchmarks that report them
+static std::atomic<std::size_t> allocation_count{0};
+
+std::size_t bench::allocations()
+{
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// each benchmark is a subcommand; argv[0] is its name
+int bench_syscalls(int argc, char **argv);
+int bench_procfs(int argc, char **argv);
+int bench_scan(int argc, char **argv);
+int bench_rank(int argc, char **argv);
+int bench_snapshot(int argc, char **argv);
+int bench_codec(int argc, char **argv);
+
+struct Benchmark
+{
+    const char *name;
+    const char *args;
+    const char *about;
+    int (*run)(int argc, char **argv);
+};
+
+static const Benchmark BENCHMARKS[] = {
+    {"syscalls", "[rounds]", "read syscalls per process scan, per-field helpers vs read_process", bench_syscalls},
+    {"procfs", "[iterations]", "/proc/stat and /proc/<pid>/stat, ifstream + istringstream vs procfs", bench_procfs},
+    {"scan", "[max threads] [extra processes] [rounds]", "ProcessTracker::refresh on 1, 2, 4, ... collector threads", bench_scan},
+    {"rank", "[top] [rounds]", "top-N rank_processes vs ordering every row, 1k/10k/50k processes", bench_rank},
+    {"snapshot", "[rounds] [dir]", "JSON vs binary snapshots: size, write, read; pre-meminfo JSON roundtrip", bench_snapshot},
+    {"codec", "[keyframe interval]", "history codec: bytes/sample, encode/decode throughput, roundtrip", bench_codec},
+};
+
+static void usage(const char *argv0)
+{
+    std::cout << "Usage: " << argv0 << " <benchmark> [args]   (all: run every benchmark with its defaults)\n\n";
+    for (const Benchmark &b : BENCHMARKS)
+        std::cout << "  " << b.name << " " << b.args << "\n      " << b.about << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)
+    {
+        usage(argv[0]);
+        return argc < 2 ? 2 : 0;
+    }
+
+    bool all = std::strcmp(argv[1], "all") == 0;
+    int rc = 0;
+    bool found = false;
+    for (const Benchmark &b : BENCHMARKS)
+    {
+        if (!all && std::strcmp(argv[1], b.name) != 0)
+            continue;
+        found = true;
+        if (all)
+            std::cout << "== " << b.name << "\n";
+        char *name = const_cast<char *>(b.name);
+        rc |= all ? b.run(1, &name) : b.run(argc - 1, argv + 1);
+    }
+    if (!found)
+    {
+        std::cerr << "buzz-bench: unknown benchmark '" << argv[1] << "'\n";
+        usage(argv[0]);
+        return 2;
+    }
+    return rc;
+}
@@ -0,0 +1,154 @@
+// user-004: parsing /proc/stat and /proc/<pid>/stat the way the collectors did
+// before procfs.hpp (std::ifstream, std::getline, std::istringstream, std::string
+// tokens) against the procfs layer, once with the read and once on bytes already
+// in memory, so the parse cost shows apart from the kernel's formatting
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cpu.hpp>
+#include <procfs.hpp>
+
+#include "bench.hpp"
+
+namespace
+{
+    // ---- before: cpu.cpp's read_totals, for every cpu line ----
+
+    std::vector<std::pair<long, long>> old_cpu_times(std::istream &in)
+    {
+        std::vector<std::pair<long, long>> out;
+        std::string line;
+        while (std::getline(in, line) && line.rfind("cpu", 0) == 0)
+        {
+            std::istringstream iss(line);
+            std::string cpu;
+            long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+            iss >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
+            long idle_time = idle + iowait;
+            out.emplace_back(idle_time, idle_time + user + nice + system + irq + softirq + steal);
+        }
+        return out;
+    }
+
+    // ---- before: processes.cpp's get_process_cpu_time, extended to the fields
+    // read_process takes from stat ----
+
+    struct PidStat
+    {
+        std::string name;
+        char state = '?';
+        long jiffies = 0, threads = 0, start_time = 0, rss = 0;
+    };
+
+    bool old_pid_stat(std::istream &in, PidStat &p)
+    {
+        std::string line;
+        std::getline(in, line);
+        size_t lparen = line.find('(');
+        size_t rparen = line.rfind(')');
+        if (lparen == std::string::npos || rparen == std::string::npos)
+            return false;
+        p.name = line.substr(lparen + 1, rparen - lparen - 1);
+        std::istringstream iss(line.substr(rparen + 2));
+        iss >> p.state;
+        long val = 0;
+        for (int field = 4; field <= 24; ++field)
+        {
+            if (!(iss >> val))
+                return false;
+            if (field == 14 || field == 15)
+                p.jiffies += val;
+            else if (field == 20)
+                p.threads = val;
+            else if (field == 22)
+                p.start_time = val;
+            else if (field == 24)
+                p.rss = val;
+        }
+        return true;
+    }
+
+    // ---- after: the same fields through procfs, as parse_stat in processes.cpp ----
+
+    bool new_pid_stat(std::string_view s, PidStat &p)
+    {
+        size_t lparen = s.find('(');
+        size_t rparen = s.rfind(')');
+        if (lparen == std::string_view::npos || rparen == std::string_view::npos || rparen + 2 >= s.size())
+            return false;
+        p.name.assign(s.substr(lparen + 1, rparen - lparen - 1));
+        p.state = s[rparen + 2];
+        procfs::Tokenizer tok(s.substr(rparen + 3));
+        long val = 0;
+        for (int field = 4; field <= 24; ++field)
+        {
+            if (!tok.next(val))
+                return false;
+            if (field == 14 || field == 15)
+                p.jiffies += val;
+            else if (field == 20)
+                p.threads = val;
+            else if (field == 22)
+                p.start_time = val;
+            else if (field == 24)
+                p.rss = val;
+        }
+        return true;
+    }
+
+    // mean us and heap allocations per call of f
+    template <typename F>
+    void measure(const char *label, int n, F &&f)
+    {
+        f();
+        std::size_t allocs = bench::allocations();
+        double ms = bench::time_ms(n, f);
+        double per_call = static_cast<double>(bench::allocations() - allocs) / n;
+        std::printf("  %-44s %8.2f us  %6.1f allocations\n", label, ms * 1000.0, per_call);
+    }
+
+    std::string slurp(const char *path)
+    {
+        std::ifstream in(path);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+}
+
+int bench_procfs(int argc, char **argv)
+{
+    int n = bench::arg(argc, argv, 1, 20000);
+    std::printf("per call, mean of %d\n", n);
+
+    procfs::Buffer buf(16384);
+    procfs::File stat("/proc/stat");
+
+    std::printf("/proc/stat, every cpu line\n");
+    measure("before: ifstream + istringstream", n, []
+            { std::ifstream in("/proc/stat"); bench::keep(old_cpu_times(in)); });
+    measure("after:  procfs::File pread + parse_cpu_times", n, [&]
+            { stat.read(buf); bench::keep(parse_cpu_times(buf.view())); });
+    std::string stat_text = slurp("/proc/stat");
+    measure("before: parse only (istringstream)", n, [&]
+            { std::istringstream in(stat_text); bench::keep(old_cpu_times(in)); });
+    measure("after:  parse only (parse_cpu_times)", n, [&]
+            { bench::keep(parse_cpu_times(stat_text)); });
+
+    std::printf("/proc/self/stat, the fields read_process uses\n");
+    PidStat p;
+    measure("before: ifstream + istringstream", n, [&]
+            { std::ifstream in("/proc/self/stat"); p = {}; bench::keep(old_pid_stat(in, p)); });
+    measure("after:  procfs::Buffer load + Tokenizer", n, [&]
+            { p = {}; bench::keep(buf.load("/proc/self/stat") && new_pid_stat(buf.view(), p)); });
+    std::string pid_text = slurp("/proc/self/stat");
+    measure("before: parse only (istringstream)", n, [&]
+            { std::istringstream in(pid_text); p = {}; bench::keep(old_pid_stat(in, p)); });
+    measure("after:  parse only (Tokenizer)", n, [&]
+            { p = {}; bench::keep(new_pid_stat(pid_text, p)); });
+    return 0;
+}
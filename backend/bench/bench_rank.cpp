@@ -0,0 +1,45 @@
+// user-012: top-N selection over a ProcessTable against ordering every row, at
+// 1k, 10k and 50k processes, for single and multi-key orders; and the cost of
+// building the table itself
+#include <random>
+#include <string>
+#include <vector>
+
+#include <process_table.hpp>
+
+#include "bench.hpp"
+#include "synthetic.hpp"
+
+int bench_rank(int argc, char **argv)
+{
+    int top = bench::arg(argc, argv, 1, 25);
+    int rounds = bench::arg(argc, argv, 2, 20);
+    const char *orders[] = {"cpu", "mem", "threads,name", "name"};
+
+    std::printf("top %d vs every row ordered, ms per frame, mean of %d\n", top, rounds);
+    std::mt19937 rng(42);
+    for (int n : {1000, 10000, 50000})
+    {
+        ProcessTable table;
+        std::vector<ProcessInfo> processes = bench::synthetic_processes(n, rng);
+        table.assign(processes);
+
+        // rebuilding the table every refresh should not allocate per row
+        std::size_t allocs = bench::allocations();
+        double build_ms = bench::time_ms(rounds, [&]
+                                         { table.assign(processes); });
+        double per_build = static_cast<double>(bench::allocations() - allocs) / rounds;
+        std::printf("  %6d procs  table build   %8.3f ms   %8.1f allocations\n", n, build_ms, per_build);
+        for (const char *order : orders)
+        {
+            std::vector<ProcessSortKey> keys;
+            parse_process_order(order, keys);
+            double top_ms = bench::time_ms(rounds, [&]
+                                           { bench::keep(rank_processes(table, keys, static_cast<size_t>(top))); });
+            double all_ms = bench::time_ms(rounds, [&]
+                                           { bench::keep(rank_processes(table, keys, table.size())); });
+            std::printf("  %6d procs  %-13s top %8.3f ms   all %8.3f ms   %5.1fx\n", n, order, top_ms, all_ms, all_ms / top_ms);
+        }
+    }
+    return 0;
+}
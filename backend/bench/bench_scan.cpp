@@ -0,0 +1,78 @@
+// user-008: one /proc scan on 1, 2, 4, ... collector threads. the scan reads two
+// files per pid and is bound by the kernel formatting them, so threads only help
+// with cores to run on; the host's core count is printed next to the results
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <processes.hpp>
+
+#include "bench.hpp"
+
+namespace
+{
+    // idle children, so a small host still has a table worth scanning
+    class Sleepers
+    {
+    public:
+        explicit Sleepers(int n)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                pid_t pid = fork();
+                if (pid == 0)
+                {
+                    for (;;)
+                        pause();
+                }
+                if (pid < 0)
+                    break;
+                pids_.push_back(pid);
+            }
+        }
+
+        ~Sleepers()
+        {
+            for (pid_t pid : pids_)
+                kill(pid, SIGKILL);
+            for (pid_t pid : pids_)
+                waitpid(pid, nullptr, 0);
+        }
+
+        size_t size() const { return pids_.size(); }
+
+    private:
+        std::vector<pid_t> pids_;
+    };
+}
+
+int bench_scan(int argc, char **argv)
+{
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    int max_threads = std::min(bench::arg(argc, argv, 1, static_cast<int>(std::max(8u, cores))), MAX_COLLECTOR_THREADS);
+    int extra = bench::arg(argc, argv, 2, 5000);
+    int rounds = bench::arg(argc, argv, 3, 10);
+
+    Sleepers sleepers(extra);
+    std::printf("%u cores, %zu extra idle processes, mean of %d refreshes\n", cores, sleepers.size(), rounds);
+    if (cores == 1)
+        std::printf("  (one core: expect no speedup, only the pool's overhead)\n");
+
+    double base = 0.0;
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        ProcessTracker tracker(threads);
+        tracker.refresh();
+        size_t rows = 0;
+        double ms = bench::time_ms(rounds, [&]
+                                   { rows = tracker.refresh().size(); });
+        if (threads == 1)
+            base = ms;
+        std::printf("  %2d threads  %6zu procs  %8.2f ms/refresh  %5.2fx\n", threads, rows, ms, base / ms);
+    }
+    return 0;
+}
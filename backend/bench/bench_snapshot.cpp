@@ -0,0 +1,129 @@
+// user-021: JSON vs binary snapshots of the same sample: size on disk, time to
+// write, and time to get the data back (parse for JSON; mmap and a column scan, or
+// a full to_sample, for binary). first checks that a snapshot in the pre-meminfo
+// JSON format keeps its memory fields through JSON and binary roundtrips
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include <sampler.hpp>
+#include <snapshot.hpp>
+#include <snapshot_binary.hpp>
+
+#include "bench.hpp"
+#include "synthetic.hpp"
+
+namespace
+{
+    long file_size(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        return in ? static_cast<long>(in.tellg()) : -1;
+    }
+
+    // the memory section as the original snapshot::make() wrote it
+    const char LEGACY_SNAPSHOT[] = R"({
+        "timestamp": "2024-05-01T12:00:00Z",
+        "cpu": {"cpu_usage": 12.5, "cpu_name": "legacy", "running_processes": 3,
+                "cpu_frequency": 2400.0, "no_of_logical_processors": 2,
+                "per_core_usage": [{"core_id": 0, "usage_percent": 10.0}, {"core_id": 1, "usage_percent": 15.0}]},
+        "memory": {"memory_usage": 42.0, "cached_memory": 123456,
+                   "free_swappable_memory": 2048, "total_swappable_memory": 4096},
+        "process_info": {}, "disk": {}, "network": {}, "battery": {}
+    })";
+
+    bool same_memory(const SystemSample &a, const SystemSample &b)
+    {
+        return a.memory_usage == b.memory_usage && a.memory.cached == b.memory.cached &&
+               a.memory.swap_free == b.memory.swap_free && a.memory.swap_total == b.memory.swap_total;
+    }
+
+    bool check_legacy_roundtrip(const std::string &bin_path, std::string *err)
+    {
+        SystemSample legacy, from_json, from_binary;
+        if (!snapshot::from_json(nlohmann::json::parse(LEGACY_SNAPSHOT), legacy, err) ||
+            !snapshot::from_json(snapshot::to_json(legacy), from_json, err) ||
+            !snapshot::save_binary(legacy, bin_path, err))
+            return false;
+        snapshot::BinarySnapshot b;
+        if (!b.open(bin_path, err) || !snapshot::to_sample(b, from_binary, err))
+            return false;
+
+        if (legacy.memory.cached != 123456 || legacy.memory.swap_free != 2048 || legacy.memory.swap_total != 4096)
+            *err = "legacy snapshot: memory fields not read";
+        else if (!same_memory(legacy, from_json))
+            *err = "legacy snapshot: memory fields lost in the JSON roundtrip";
+        else if (!same_memory(legacy, from_binary))
+            *err = "legacy snapshot: memory fields lost in the binary roundtrip";
+        return err->empty();
+    }
+}
+
+int bench_snapshot(int argc, char **argv)
+{
+    int rounds = bench::arg(argc, argv, 1, 20);
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+    const std::string json_path = dir + "/buzz-bench-snapshot.json";
+    const std::string bin_path = dir + "/buzz-bench-snapshot.bin";
+
+    std::string err;
+    if (!check_legacy_roundtrip(bin_path, &err))
+    {
+        std::fprintf(stderr, "buzz-bench: %s\n", err.c_str());
+        return 1;
+    }
+    std::printf("legacy JSON snapshot: memory fields survive JSON and binary roundtrips\n");
+
+    // real system sections, synthetic process tables
+    Sampler sampler;
+    sampler.tick();
+    SystemSample s = sampler.tick();
+    std::mt19937 rng(42);
+
+    std::printf("mean of %d, files in %s\n", rounds, dir.c_str());
+    std::printf("  %7s | %10s %9s %11s | %10s %9s %10s %10s\n", "procs", "json size", "write", "read+parse",
+                "bin size", "write", "mmap+scan", "to_sample");
+    for (int n : {1000, 5000, 20000})
+    {
+        s.set_processes(bench::synthetic_processes(n, rng));
+
+        double json_write = bench::time_ms(rounds, [&]
+                                           { snapshot::save_to_file(snapshot::to_json(s), json_path, &err); });
+        double bin_write = bench::time_ms(rounds, [&]
+                                          { snapshot::save_binary(s, bin_path, &err); });
+        double json_read = bench::time_ms(rounds, [&]
+                                          {
+            std::ifstream in(json_path);
+            SystemSample out;
+            snapshot::from_json(nlohmann::json::parse(in), out, &err);
+            bench::keep(out); });
+        double bin_scan = bench::time_ms(rounds, [&]
+                                         {
+            snapshot::BinarySnapshot b;
+            b.open(bin_path, &err);
+            double sum = 0.0;
+            for (double v : b.column<double>(snapshot::ColumnId::ProcCpuUsage))
+                sum += v;
+            bench::keep(sum); });
+        double bin_sample = bench::time_ms(rounds, [&]
+                                           {
+            snapshot::BinarySnapshot b;
+            SystemSample out;
+            if (b.open(bin_path, &err))
+                snapshot::to_sample(b, out, &err);
+            bench::keep(out); });
+        if (!err.empty())
+        {
+            std::fprintf(stderr, "buzz-bench: %s\n", err.c_str());
+            return 1;
+        }
+
+        std::printf("  %7d | %8.2f MB %6.2f ms %8.2f ms | %7.0f KB %6.2f ms %7.3f ms %7.2f ms\n", n,
+                    static_cast<double>(file_size(json_path)) / 1e6, json_write, json_read,
+                    static_cast<double>(file_size(bin_path)) / 1e3, bin_write, bin_scan, bin_sample);
+    }
+    std::remove(json_path.c_str());
+    std::remove(bin_path.c_str());
+    return 0;
+}
@@ -0,0 +1,212 @@
+// user-001: syscalls of one process scan. the per-field helpers that
+// get_all_processes() used before read_process() are kept here verbatim (minus
+// the 500 ms sleep between passes) as the baseline
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <pwd.h>
+#include <unistd.h>
+
+#include <memory.hpp>
+#include <processes.hpp>
+
+#include "bench.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct LegacyProcess
+    {
+        int pid = 0;
+        std::string process_name, status, user;
+        long memory_usage = 0;
+        int threads = 0;
+        double cpu_time = 0.0;
+    };
+
+    std::string get_process_name(int pid)
+    {
+        std::ifstream comm("/proc/" + std::to_string(pid) + "/comm");
+        std::string name;
+        getline(comm, name);
+        return name;
+    }
+
+    uid_t get_process_uid(int pid)
+    {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        std::string key;
+        uid_t uid = static_cast<uid_t>(-1);
+        while (status >> key)
+        {
+            if (key == "Uid:")
+            {
+                status >> uid;
+                break;
+            }
+        }
+        return uid;
+    }
+
+    long get_process_memory_usage(int pid)
+    {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        long rss_kb = 0;
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.rfind("VmRSS:", 0) == 0)
+            {
+                std::istringstream iss(line.substr(6));
+                std::string unit;
+                iss >> rss_kb >> unit;
+                break;
+            }
+        }
+        if (rss_kb == 0)
+        {
+            std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+            long size_pages = 0, resident_pages = 0;
+            if (statm >> size_pages >> resident_pages)
+                rss_kb = resident_pages * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+        return rss_kb;
+    }
+
+    int get_thread_count(int pid)
+    {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        std::string key;
+        int threads = 0;
+        while (status >> key)
+        {
+            if (key == "Threads:")
+            {
+                status >> threads;
+                break;
+            }
+        }
+        return threads;
+    }
+
+    std::string get_process_status(int pid)
+    {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        std::string key, state = "Unknown";
+        while (status >> key)
+        {
+            if (key == "State:")
+            {
+                status >> state;
+                break;
+            }
+        }
+        return state;
+    }
+
+    long read_process_jiffies(int pid)
+    {
+        std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+        std::string line;
+        std::getline(stat, line);
+        size_t rparen = line.rfind(')');
+        if (rparen == std::string::npos)
+            return 0;
+        std::istringstream iss(line.substr(rparen + 2));
+        char state = '\0';
+        iss >> state;
+        long val = 0, utime = 0, stime = 0;
+        for (int field = 4; field <= 15; ++field)
+        {
+            if (!(iss >> val))
+                return 0;
+            if (field == 14)
+                utime = val;
+            else if (field == 15)
+                stime = val;
+        }
+        return utime + stime;
+    }
+
+    std::vector<LegacyProcess> legacy_scan()
+    {
+        std::vector<LegacyProcess> processes;
+        std::unordered_map<int, long> proc0;
+        for (const auto &entry : fs::directory_iterator("/proc"))
+        {
+            if (!entry.is_directory())
+                continue;
+            std::string dirname = entry.path().filename();
+            if (!std::all_of(dirname.begin(), dirname.end(), ::isdigit))
+                continue;
+            int pid = std::stoi(dirname);
+
+            LegacyProcess p;
+            p.pid = pid;
+            p.process_name = get_process_name(pid);
+            p.status = get_process_status(pid);
+            p.memory_usage = get_process_memory_usage(pid);
+            p.threads = get_thread_count(pid);
+            p.cpu_time = static_cast<double>(read_process_jiffies(pid)); // get_process_cpu_time
+            struct passwd *pwd = getpwuid(get_process_uid(pid));
+            p.user = pwd ? pwd->pw_name : "unknown";
+            processes.push_back(p);
+            proc0[pid] = read_process_jiffies(pid);
+        }
+
+        std::vector<LegacyProcess> alive;
+        for (auto &p : processes)
+        {
+            if (!fs::exists("/proc/" + std::to_string(p.pid)))
+                continue;
+            p.cpu_time = static_cast<double>(read_process_jiffies(p.pid) - proc0[p.pid]);
+            alive.push_back(std::move(p));
+        }
+        return alive;
+    }
+
+    // read syscalls and wall time of one call of scan, averaged over rounds
+    template <typename F>
+    void measure(const char *label, int rounds, F &&scan)
+    {
+        scan(); // warm the page cache, the user cache and the tracker
+        size_t rows = 0;
+        long before = bench::read_syscalls();
+        auto start = bench::Clock::now();
+        for (int i = 0; i < rounds; ++i)
+            rows = scan();
+        double ms = bench::ms_since(start) / rounds;
+        double reads = static_cast<double>(bench::read_syscalls() - before) / rounds;
+        std::printf("  %-40s %6zu procs  %8.0f reads  %5.2f reads/proc  %8.2f ms\n", label, rows, reads,
+                    rows ? reads / static_cast<double>(rows) : 0.0, ms);
+    }
+}
+
+int bench_syscalls(int argc, char **argv)
+{
+    int rounds = bench::arg(argc, argv, 1, 5);
+    std::printf("read syscalls per scan, mean of %d (syscr from /proc/self/io)\n", rounds);
+
+    measure("per-field helpers, two passes", rounds, []
+            { return legacy_scan().size(); });
+
+    // the same two passes through read_process, as get_all_processes() does them
+    measure("read_process, two passes", rounds, []
+            {
+                ProcessTracker tracker;
+                tracker.refresh();
+                return tracker.refresh().size(); });
+
+    // what a sampler tick pays: one pass against the previous refresh
+    ProcessTracker tracker;
+    measure("ProcessTracker::refresh, one pass", rounds, [&]
+            { return tracker.refresh().size(); });
+    return 0;
+}
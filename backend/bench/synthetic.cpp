@@ -0,0 +1,130 @@
+#include "synthetic.hpp"
+
+#include <cmath>
+#include <string>
+
+#include <users.hpp>
+
+namespace bench
+{
+    constexpr long MEM_TOTAL_KB = 32L * 1024 * 1024;
+
+    static double percent_of_memory(long kb)
+    {
+        return 100.0 * static_cast<double>(kb) / static_cast<double>(MEM_TOTAL_KB);
+    }
+
+    static ProcessInfo synthetic_process(int pid, std::mt19937 &rng)
+    {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        ProcessInfo p{};
+        p.pid = pid;
+        p.process_name = "proc-" + std::to_string(rng() % 300);
+        p.user = user_cache().intern(pid % 4 == 0 ? "root" : "user" + std::to_string(rng() % 10));
+        p.type = unit(rng) < 0.3 ? "app" : "background process";
+        p.state = unit(rng) < 0.05 ? 'R' : 'S';
+        p.status = process_status_name(p.state);
+        p.memory_usage = 1000 + static_cast<long>(rng() % 200000) / 4 * 4;
+        p.memory_percent = percent_of_memory(p.memory_usage);
+        p.threads = 1 + static_cast<int>(rng() % 20);
+        p.cpu.cpu_time = static_cast<double>(rng() % 100000) / 100.0; // whole jiffies
+        p.cpu.cpu_usage = unit(rng) < 0.1 ? static_cast<double>(rng() % 60) * 0.0625 : 0.0;
+        return p;
+    }
+
+    std::vector<ProcessInfo> synthetic_processes(int n, std::mt19937 &rng)
+    {
+        std::vector<ProcessInfo> out;
+        out.reserve(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i)
+            out.push_back(synthetic_process(300 + i, rng));
+        return out;
+    }
+
+    std::vector<SystemSample> synthetic_recording(const SystemSample &base, int processes, int ticks, std::mt19937 &rng)
+    {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::vector<ProcessInfo> rows = synthetic_processes(processes, rng);
+        // per row: uses CPU, and utime + stime in jiffies, which cpu_time is derived
+        // from as ProcessTracker does
+        std::vector<bool> busy(rows.size());
+        std::vector<long> jiffies(rows.size());
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            busy[i] = rows[i].cpu.cpu_usage > 0.0;
+            jiffies[i] = std::lround(rows[i].cpu.cpu_time * 100.0);
+        }
+        int next_pid = 300 + processes;
+
+        std::vector<SystemSample> out;
+        out.reserve(static_cast<size_t>(ticks));
+        auto when = std::chrono::system_clock::now();
+        for (int t = 0; t < ticks; ++t)
+        {
+            when += std::chrono::milliseconds(1000) + std::chrono::microseconds(rng() % 2000);
+            for (int k = 0; k < 2 && !rows.empty(); ++k)
+            {
+                size_t gone = rng() % rows.size();
+                rows.erase(rows.begin() + static_cast<long>(gone));
+                busy.erase(busy.begin() + static_cast<long>(gone));
+                jiffies.erase(jiffies.begin() + static_cast<long>(gone));
+            }
+            for (int k = 0; k < 2; ++k)
+            {
+                rows.push_back(synthetic_process(next_pid++, rng));
+                busy.push_back(unit(rng) < 0.1);
+                jiffies.push_back(std::lround(rows.back().cpu.cpu_time * 100.0));
+            }
+
+            SystemSample s = base;
+            s.timestamp = when;
+            s.interval_s = 1.0 + static_cast<double>(rng() % 2000) / 1e6;
+            s.cpu_usage = unit(rng) * 40.0;
+            s.memory_usage = 40.0 + unit(rng);
+            for (double &core : s.per_core_usage)
+                core = unit(rng) * 100.0;
+            for (DiskStats &d : s.disks)
+            {
+                d.reads_completed += t * 3;
+                d.sectors_read += t * 24;
+                d.read_rate = static_cast<double>(rng() % 100) * 4096.0;
+            }
+            for (NetworkStats &n : s.network)
+            {
+                n.download_rate = static_cast<double>(rng() % 50000);
+                n.upload_rate = static_cast<double>(rng() % 5000);
+            }
+            s.memory.mem_free -= t * 4;
+            s.memory.mem_available -= t * 4;
+
+            for (size_t i = 0; i < rows.size(); ++i)
+            {
+                ProcessInfo &p = rows[i];
+                if (!busy[i])
+                {
+                    p.cpu.cpu_usage = 0.0;
+                    continue;
+                }
+                // a 100 Hz clock on 16 cores
+                long used = static_cast<long>(rng() % 60);
+                jiffies[i] += used;
+                p.cpu.cpu_time = static_cast<double>(jiffies[i]) / 100.0;
+                p.cpu.cpu_usage = static_cast<double>(used) * 100.0 / 1600.0 * 16.0;
+                if (unit(rng) < 0.3)
+                {
+                    p.memory_usage += (static_cast<long>(rng() % 129) - 64) * 4;
+                    p.memory_percent = percent_of_memory(p.memory_usage);
+                }
+                char state = unit(rng) < 0.5 ? 'R' : 'S';
+                if (state != p.state)
+                {
+                    p.state = state;
+                    p.status = process_status_name(state);
+                }
+            }
+            s.set_processes(rows);
+            out.push_back(std::move(s));
+        }
+        return out;
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef SYNTHETIC_HPP
+#define SYNTHETIC_HPP
+
+#include <random>
+#include <vector>
+
+#include <processes.hpp>
+#include <sampler.hpp>
+
+namespace bench
+{
+    // n process rows shaped like a busy host's, in pid order: a few hundred distinct
+    // names over ten users, a tenth of the rows using CPU, the rest idle
+    std::vector<ProcessInfo> synthetic_processes(int n, std::mt19937 &rng);
+
+    // ticks consecutive 1 s samples of a host with that kind of table: base's
+    // system sections with rates and counters moving, the busy tenth accumulating
+    // CPU time and shifting RSS, and two processes exiting and two starting a tick
+    std::vector<SystemSample> synthetic_recording(const SystemSample &base, int processes, int ticks, std::mt19937 &rng);
+}
+
+#endif
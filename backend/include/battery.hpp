@@ -12,5 +12,6 @@ struct BatteryInfo
 
 BatteryInfo get_battery_info();
 nlohmann::json battery_to_json(const BatteryInfo &b);
+BatteryInfo battery_from_json(const nlohmann::json &j);
 
 #endif
@@ -0,0 +1,121 @@
+#ifndef CODEC_HPP
+#define CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sampler.hpp>
+
+// compact encoding of consecutive samples for the history ring. each frame is
+// coded against the one before it, so the many values that don't move between
+// ticks cost a bit each:
+//  - timestamp: delta-of-delta, so a steady cadence costs a few bytes at most
+//  - doubles (CPU%, CPU time, rates, ...): XOR with the series' previous value,
+//    Gorilla style: a 0 bit if equal, otherwise only the bits between the leading
+//    and trailing zeros, reusing the previous window when it still fits
+//  - integers (RSS, threads, meminfo, disk counters): a 0 bit if unchanged,
+//    otherwise the zigzag varint of the delta
+//  - process rows are matched to the previous frame's by pid, walking both in pid
+//    order; a row whose pid is the next one expected costs a bit for the pid
+//  - names, users, states and devices go through a dictionary of strings that
+//    grows with the stream
+// a keyframe starts from empty state, so decoding can begin at any keyframe
+namespace codec
+{
+    class BitWriter;
+    class BitReader;
+
+    constexpr std::uint32_t NO_ID = UINT32_MAX;
+
+    // per-series state of the XOR coding
+    struct DoubleSeries
+    {
+        std::uint64_t prev = 0; // bits of the previous value
+        int lead = -1;          // window of the previous non-zero XOR, -1 for none
+        int trail = 0;
+    };
+
+    // what a frame is coded against; encoder and decoder evolve it identically
+    struct State
+    {
+        struct Row
+        {
+            int pid = 0;
+            std::uint32_t name = NO_ID, user = NO_ID, type = NO_ID, status = NO_ID; // dictionary ids
+            char state = 0;
+            DoubleSeries cpu_usage, cpu_time, memory_percent;
+            std::int64_t memory_kb = 0;
+            std::int64_t threads = 0;
+        };
+        // a disk or a network interface, matched by position
+        struct Device
+        {
+            std::uint32_t name = NO_ID;
+            std::int64_t counters[4] = {};
+            DoubleSeries values[4];
+        };
+
+        bool primed = false; // a frame was coded since the last keyframe
+        std::int64_t timestamp = 0;
+        std::int64_t timestamp_delta = 0;
+        DoubleSeries interval, cpu_usage, cpu_frequency, memory_usage;
+        std::int64_t running_processes = 0, logical_processors = 0, battery_charge = 0;
+        std::uint32_t cpu_name = NO_ID, battery_status = NO_ID;
+        std::vector<DoubleSeries> core_usage, core_frequency;
+        std::shared_ptr<const CpuTopology> topology;
+        std::int64_t meminfo[MEMINFO_FIELD_COUNT] = {};
+        std::vector<Row> rows; // previous frame's processes, in its order
+        std::vector<Device> disks, interfaces;
+        std::vector<std::string> strings; // dictionary, by id
+
+        void reset();
+    };
+
+    class Encoder
+    {
+    public:
+        // append one frame for s to out; the first frame after construction
+        // is always a keyframe
+        void encode(const SystemSample &s, bool keyframe, std::string &out);
+
+    private:
+        void put_string(BitWriter &w, const std::string &str, std::uint32_t &id);
+        void put_field(BitWriter &w, const std::string &str, std::uint32_t &id);
+        void put_processes(BitWriter &w, const std::vector<ProcessInfo> &processes);
+
+        State state_;
+        std::unordered_map<std::string, std::uint32_t> ids_; // inverse of state_.strings
+        std::vector<std::uint32_t> users_;                   // UserId -> dictionary id
+        std::vector<State::Row> next_rows_;                  // reused every frame
+    };
+
+    class Decoder
+    {
+    public:
+        // decode one frame into out; a delta frame needs the frame before it
+        // decoded by this decoder first
+        bool decode(const char *data, std::size_t size, SystemSample &out, std::string *err = nullptr);
+
+        // true once a frame was decoded: the next delta frame can follow
+        bool primed() const { return state_.primed; }
+
+    private:
+        bool get_string(BitReader &r, std::uint32_t &id);
+        bool get_field(BitReader &r, std::uint32_t &id);
+        bool get_processes(BitReader &r, std::vector<ProcessInfo> &processes);
+
+        State state_;
+        std::vector<UserId> users_; // dictionary id -> UserId, filled on first use
+        std::vector<State::Row> next_rows_;
+        std::shared_ptr<ProcessScan> scan_; // the last scan decoded, reused once no sample holds it
+    };
+
+    // true if the frame in data is a keyframe
+    bool is_keyframe(const char *data, std::size_t size);
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef COLLECTOR_HPP
+#define COLLECTOR_HPP
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cpu.hpp>
+#include <memory.hpp>
+#include <processes.hpp>
+#include <procfs.hpp>
+
+struct SystemSample;
+class Collector;
+
+// rough price of one run, for choosing intervals
+enum class CollectorCost
+{
+    Cheap,     // one pread of a small /proc file
+    Moderate,  // a handful of sysfs files
+    Expensive, // a walk over every process
+};
+
+const char *collector_cost_name(CollectorCost cost);
+
+// a built-in source of part of a SystemSample. the registry lists them in the
+// order a tick runs them: the process scan last, so the cheap files are read
+// back to back and describe the same instant
+struct CollectorInfo
+{
+    const char *name;
+    CollectorCost cost;
+    std::chrono::milliseconds interval; // default: 0 runs it every tick
+    unsigned sections;                  // snapshot::Section bits it fills
+    const char *reads;                  // for --collect help
+
+    // builds the collector; processes is the tracker the process scan refreshes
+    std::unique_ptr<Collector> (*make)(ProcessTracker &processes);
+};
+
+constexpr std::size_t BUILTIN_COLLECTOR_COUNT = 7;
+extern const CollectorInfo BUILTIN_COLLECTORS[BUILTIN_COLLECTOR_COUNT];
+
+// --collect: per collector, off or an interval. collectors not named keep their
+// default interval
+struct CollectorSetting
+{
+    bool enabled = true;
+    std::chrono::milliseconds interval{-1}; // -1: the collector's default
+};
+using CollectorConfig = std::map<std::string, CollectorSetting>;
+
+// parse a comma-separated list of "<name>=off", "<name>=on" or "<name>=<interval>"
+// with the interval in ms or with a "ms"/"s" suffix ("processes=5s,battery=off")
+bool parse_collectors(std::string_view spec, CollectorConfig &config, std::string *err = nullptr);
+
+// snapshot sections that the enabled built-in collectors fill
+unsigned collected_sections(const CollectorConfig &config);
+
+// turn off the collectors that fill none of sections. collectors the config
+// already names are left as they are
+void disable_unused_collectors(unsigned sections, CollectorConfig &config);
+
+// the shared system files of one tick. each is read at most once per tick and
+// only when a collector due in that tick asks for it, so collectors that share a
+// file (processes need the /proc/stat and /proc/meminfo totals) share the read
+class TickInputs
+{
+public:
+    // start a tick: earlier reads are stale from now on
+    void begin(std::chrono::steady_clock::time_point now);
+    std::chrono::steady_clock::time_point now() const { return now_; }
+
+    const std::vector<CpuTimes> &cpu_times(); // /proc/stat, aggregate line first
+    long long running_processes();            // /proc/stat
+    const MemInfo &memory();                  // /proc/meminfo
+    std::string_view net_dev();
+    std::string_view diskstats();
+    const std::shared_ptr<const CpuTopology> &topology(); // cached; rebuilt only on hotplug
+
+private:
+    std::string_view stat();
+
+    std::chrono::steady_clock::time_point now_;
+    unsigned read_ = 0; // bits of what this tick already read
+
+    procfs::File stat_file_{"/proc/stat"};
+    procfs::File meminfo_file_{"/proc/meminfo"};
+    procfs::File net_dev_file_{"/proc/net/dev"};
+    procfs::File diskstats_file_{"/proc/diskstats"};
+    procfs::Buffer stat_buf_{16384};
+    procfs::Buffer meminfo_buf_{8192};
+    procfs::Buffer net_dev_buf_{4096};
+    procfs::Buffer diskstats_buf_{8192};
+
+    std::vector<CpuTimes> cpu_;
+    MemInfo memory_;
+    std::shared_ptr<const CpuTopology> topology_;
+};
+
+// a source of part of a SystemSample, run by Sampler on its own interval. rates
+// cover the time since the collector's previous run, however long that was
+class Collector
+{
+public:
+    virtual ~Collector() = default;
+
+    // sample now into s
+    virtual void collect(TickInputs &in, SystemSample &s) = 0;
+
+    // not due this tick: keep showing what the previous sample had
+    virtual void carry(const SystemSample &prev, SystemSample &s) = 0;
+};
+
+#endif
@@ -1,13 +1,66 @@
 #ifndef CPU_HPP
 #define CPU_HPP
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+struct CpuCache
+{
+    int level;
+    std::string type; // "Data", "Instruction" or "Unified"
+    long size_kb;
+};
+
+// static CPU identity and layout, from /proc/cpuinfo and /sys/devices/system
+struct CpuTopology
+{
+    std::string model_name;
+    int logical_cpus = 0;     // online logical cpus
+    int physical_cores = 0;   // distinct (package, core) pairs
+    int sockets = 0;          // distinct physical packages
+    int numa_nodes = 0;
+    int threads_per_core = 1; // SMT siblings per core
+    std::vector<int> online;  // ids of the online cpus
+    std::vector<CpuCache> caches; // as seen by the first online cpu
+    std::vector<double> base_mhz; // per cpu "cpu MHz" from cpuinfo, used when cpufreq is absent
+};
+
+// built once and reused; rebuilt only when /sys/devices/system/cpu/online changes (hotplug)
+std::shared_ptr<const CpuTopology> cpu_topology();
+
+// current MHz of every online cpu from cpufreq/scaling_cur_freq
+// (the cpuinfo value captured with the topology on hosts without cpufreq)
+std::vector<double> get_per_core_frequency();
+
+// raw jiffy counters of one "cpu" line in /proc/stat
+struct CpuTimes
+{
+    long idle;  // idle + iowait
+    long total; // idle + non-idle
+};
+
+// read the aggregate "cpu" line followed by one entry per core
+std::vector<CpuTimes> read_cpu_times();
+
+// parsers over an already loaded /proc/stat or /proc/cpuinfo, so one read can
+// feed every consumer of a tick
+std::vector<CpuTimes> parse_cpu_times(std::string_view stat);
+long long parse_running_processes(std::string_view stat);
+std::string parse_cpu_name(std::string_view cpuinfo);
+int parse_logical_processors(std::string_view cpuinfo);
+
+// busy % between two readings of the same cpu line, clamped to [0, 100]
+double cpu_usage_between(const CpuTimes &prev, const CpuTimes &cur);
+
+// usage since the previous call (0 on the first call)
 double get_cpu_usage();
+// identity getters are served from cpu_topology(); frequency is the mean across cores
 std::string get_cpu_name();
 long long get_running_processes();
 double get_cpu_frequency();
 int get_no_logical_processors();
+// per-core usage since the previous call (all zeros on the first call)
 std::vector<double> get_per_core_usage();
 
 #endif
@@ -2,6 +2,7 @@
 #define DISK_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <nlohmann/json.hpp>
 
@@ -14,9 +15,16 @@ struct DiskStats
     long sectors_written;
     double read_time_ms;
     double write_time_ms;
+    double read_rate;  // bytes/sec since the previous sample (0 if none)
+    double write_rate; // bytes/sec since the previous sample (0 if none)
 };
 
 std::vector<DiskStats> get_disk_stats();
+std::vector<DiskStats> parse_disk_stats(std::string_view diskstats); // already loaded /proc/diskstats
+
+// fill read/write rates of `cur` from the sector counters of `prev`, taken `seconds` earlier
+void compute_disk_rates(std::vector<DiskStats> &cur, const std::vector<DiskStats> &prev, double seconds);
 nlohmann::json disk_to_json(const DiskStats &d);
+DiskStats disk_from_json(const nlohmann::json &j);
 
 #endif
\ No newline at end of file
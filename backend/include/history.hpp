@@ -0,0 +1,158 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <codec.hpp>
+#include <snapshot_binary.hpp>
+
+// on-disk history: a fixed-size file, mapped shared, used as a ring of records.
+// each record is one tick, either a binary snapshot (see snapshot_binary.hpp)
+// that a reader attaches to in place, or a codec frame (see codec.hpp): a
+// keyframe every KEYFRAME_INTERVAL records and deltas against the previous
+// record in between, about 20x smaller. the writer emits codec frames; a delta
+// whose keyframe was overwritten can't be decoded and is left out of the index.
+//
+//   RingHeader (one page) | data: RecordHeader + payload, 8 byte aligned, ...
+//
+// records never straddle the end of the data area: a WRAP marker (or less than a
+// record header of space) sends readers back to the start. appending first moves
+// `tail` past every old record the new one will overwrite, then writes the record,
+// then publishes it by advancing `head` and `next_seq`. a crash at any point leaves
+// tail..head intact; a record torn by an OS crash (nothing is fsynced) fails its
+// checksum and ends the readable history there
+namespace history
+{
+    constexpr char RING_MAGIC[8] = {'B', 'U', 'Z', 'Z', 'R', 'I', 'N', 'G'};
+    constexpr std::uint32_t RING_VERSION = 1;
+    constexpr std::uint32_t RECORD_MAGIC = 0x43525a42;   // "BZRC": binary snapshot
+    constexpr std::uint32_t KEYFRAME_MAGIC = 0x464b5a42; // "BZKF": codec keyframe
+    constexpr std::uint32_t DELTA_MAGIC = 0x4c445a42;    // "BZDL": codec delta frame
+    constexpr std::uint32_t WRAP_MAGIC = 0x52575a42;     // "BZWR"
+    constexpr std::size_t HEADER_BYTES = 4096;
+
+    struct RingHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t endian; // snapshot::BINARY_ENDIAN
+        std::uint64_t capacity; // bytes of the data area
+        std::uint64_t head;     // next write offset into the data area
+        std::uint64_t tail;     // offset of the oldest record
+        std::uint64_t first_seq; // seq of the record at tail
+        std::uint64_t next_seq;  // seq the next record gets
+    };
+
+    struct RecordHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t size; // payload bytes
+        std::uint64_t seq;
+        std::int64_t timestamp_ns; // copy of the payload's, so an index needs no payload pages
+        std::uint64_t checksum;    // of the payload
+    };
+
+    // default ring size for --record
+    constexpr std::size_t DEFAULT_RING_BYTES = 256u << 20;
+
+    // --record's process scan interval unless --collect names the processes
+    // collector: scanning 5k pids costs about 100 ms of CPU, so scanning it every
+    // 1 s tick alone would take 10% of a core. the system-wide collectors keep the
+    // refresh interval
+    constexpr std::chrono::milliseconds RECORD_PROCESS_INTERVAL{30000};
+
+    // records per keyframe: reading a record decodes at most this many frames
+    constexpr unsigned KEYFRAME_INTERVAL = 60;
+
+    // path of the ring file inside a --record directory
+    std::string ring_path(const std::string &dir);
+
+    // appends samples to a ring file, creating it (fully allocated) if needed and
+    // continuing after the last record if it already exists
+    class HistoryWriter
+    {
+    public:
+        HistoryWriter() = default;
+        ~HistoryWriter();
+
+        HistoryWriter(const HistoryWriter &) = delete;
+        HistoryWriter &operator=(const HistoryWriter &) = delete;
+
+        // bytes is the whole file size; ignored when the ring already exists
+        bool open(const std::string &path, std::size_t bytes, std::string *err = nullptr);
+
+        // false if the sample doesn't fit in the ring at all
+        bool append(const SystemSample &s, std::string *err = nullptr);
+
+        std::uint64_t records() const { return header_->next_seq - header_->first_seq; }
+
+    private:
+        void evict(std::uint64_t from, std::uint64_t to);
+        char *data() const { return map_ + HEADER_BYTES; }
+
+        int fd_ = -1;
+        char *map_ = nullptr;
+        std::size_t size_ = 0;
+        RingHeader *header_ = nullptr;
+        codec::Encoder encoder_;
+        std::string frame_; // reused every tick
+        unsigned since_key_ = KEYFRAME_INTERVAL; // so the first record is a keyframe
+    };
+
+    // read-only view of a ring file: an index of every readable record, in order
+    class HistoryReader
+    {
+    public:
+        struct Entry
+        {
+            std::int64_t timestamp_ns;
+            std::uint64_t seq;
+            std::uint64_t offset; // of the RecordHeader in the data area
+            std::uint32_t size;
+            std::uint32_t magic; // RECORD_MAGIC, KEYFRAME_MAGIC or DELTA_MAGIC
+            std::size_t key;     // index of the entry decoding starts from: its keyframe, or itself
+        };
+
+        HistoryReader() = default;
+        ~HistoryReader();
+
+        HistoryReader(const HistoryReader &) = delete;
+        HistoryReader &operator=(const HistoryReader &) = delete;
+
+        // map the file and index its records from the headers alone
+        bool open(const std::string &path, std::string *err = nullptr);
+
+        const std::vector<Entry> &entries() const { return entries_; }
+        std::size_t size() const { return entries_.size(); }
+
+        // the i-th record if it is a binary snapshot, checksummed and attached in place
+        bool record(std::size_t i, snapshot::BinarySnapshot &out, std::string *err = nullptr) const;
+
+        // the i-th record as a sample, whatever its format. a codec frame is decoded
+        // from its keyframe, or just from the last record asked for when that one
+        // was i - 1, so playing forward decodes each frame once
+        bool sample(std::size_t i, SystemSample &out, std::string *err = nullptr);
+
+    private:
+        const char *payload(std::size_t i, std::string *err) const;
+
+        const char *map_ = nullptr;
+        std::size_t size_ = 0;
+        std::vector<Entry> entries_;
+
+        codec::Decoder decoder_;
+        std::size_t decoded_ = SIZE_MAX; // entry the decoder state belongs to
+        SystemSample skipped_;           // reused for the frames decoded on the way
+    };
+
+    // --record: sample every interval into the ring in dir until SIGINT/SIGTERM,
+    // scanning processes every RECORD_PROCESS_INTERVAL unless collectors says otherwise
+    int record(const std::string &dir, std::size_t bytes, int collector_threads, ProcessBackend backend,
+               std::chrono::milliseconds interval, const CollectorConfig &collectors = {});
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+
+#include <render.hpp>
+
+// rows given to each panel of a frame; a panel with 0 rows is hidden
+struct PanelPlan
+{
+    size_t process_rows = 0; // process list viewport
+    size_t core_rows = 0;
+    size_t network_rows = 0;
+    size_t disk_rows = 0;
+    bool show_cores = false;
+    bool show_network = false;
+    bool show_disks = false;
+};
+
+// terminal geometry and everything derived from it. the size is only queried by
+// update() (startup and SIGWINCH); column widths are computed once per size, and
+// the panel plan only when the size or a panel's row count changes
+class Layout
+{
+public:
+    // re-read the terminal size; true if it changed
+    bool update(int fd = STDOUT_FILENO);
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+    // one width per column, 0 for columns hidden to fit the terminal width
+    const std::vector<size_t> &widths(const std::vector<render::Column> &columns);
+
+    // fit the panels to the terminal height: the process list gets at least a few
+    // rows, the core/network/disk tables follow in that order (truncated or hidden
+    // when short of space), and whatever is left grows the process list up to max
+    const PanelPlan &plan(size_t summary_rows, size_t max_process_rows, size_t cores, size_t interfaces, size_t disks);
+
+private:
+    int rows_ = 50;
+    int cols_ = 120;
+    std::unordered_map<const std::vector<render::Column> *, std::vector<size_t>> widths_;
+
+    size_t plan_key_[5] = {};
+    bool plan_valid_ = false;
+    PanelPlan plan_;
+};
+
+#endif
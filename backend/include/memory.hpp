@@ -1,8 +1,61 @@
 #ifndef MEMORY_HPP
 #define MEMORY_HPP
 #include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+// one pass over /proc/meminfo; values are kB except the HugePages_* counts (pages)
+// keys missing on older kernels stay 0
+struct MemInfo
+{
+    long mem_total = 0;
+    long mem_free = 0;
+    long mem_available = 0;
+    long buffers = 0;
+    long cached = 0;
+    long swap_cached = 0;
+    long active = 0;
+    long inactive = 0;
+    long swap_total = 0;
+    long swap_free = 0;
+    long dirty = 0;
+    long writeback = 0;
+    long anon_pages = 0;
+    long mapped = 0;
+    long shmem = 0;
+    long slab = 0;
+    long s_reclaimable = 0;
+    long s_unreclaim = 0;
+    long kernel_stack = 0;
+    long page_tables = 0;
+    long commit_limit = 0;
+    long committed_as = 0;
+    long huge_pages_total = 0;
+    long huge_pages_free = 0;
+    long huge_pages_rsvd = 0;
+    long huge_pages_surp = 0;
+    long hugepagesize = 0;
+};
+
+MemInfo read_meminfo();
+MemInfo parse_meminfo(std::string_view meminfo); // already loaded /proc/meminfo
+
+// % of MemTotal not available (0 if MemTotal is unknown)
+double memory_usage_percent(const MemInfo &m);
+
+// every MemInfo counter and its JSON key, in a fixed order
+struct MemInfoField
+{
+    const char *key;
+    long MemInfo::*member;
+};
+constexpr size_t MEMINFO_FIELD_COUNT = 27;
+extern const MemInfoField MEMINFO_FIELDS[MEMINFO_FIELD_COUNT];
+
+nlohmann::json meminfo_to_json(const MemInfo &m);
+MemInfo meminfo_from_json(const nlohmann::json &j); // missing keys stay 0
 
 double get_memory_usage();
 long get_mem_value(std::string mem_value);
 
-#endif
\ No newline at end of file
+#endif
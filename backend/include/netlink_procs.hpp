@@ -0,0 +1,53 @@
+#ifndef NETLINK_PROCS_HPP
+#define NETLINK_PROCS_HPP
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/types.h>
+
+// process source driven by the kernel instead of /proc listings:
+// - the proc connector (NETLINK_CONNECTOR) streams fork/exec/uid/exit events,
+//   so the pid set is kept current without re-reading /proc each tick
+// - taskstats (generic netlink) reports a task's uid when it appears or execs,
+//   so /proc/<pid>/status never has to be parsed
+// both need CAP_NET_ADMIN; open() fails cleanly otherwise so callers can fall back
+class NetlinkProcessSource
+{
+public:
+    NetlinkProcessSource() = default;
+    ~NetlinkProcessSource();
+
+    NetlinkProcessSource(const NetlinkProcessSource &) = delete;
+    NetlinkProcessSource &operator=(const NetlinkProcessSource &) = delete;
+
+    // subscribe to process events and seed the pid set from /proc once
+    bool open(std::string *err = nullptr);
+
+    bool is_open() const { return events_fd_ >= 0; }
+
+    // apply pending events and return the live tgids, ascending; uids of new
+    // or exec'd processes are looked up here so uid() is a plain map read
+    const std::vector<int> &pids();
+
+    // owner of tgid as of the last pids() call; false if unknown
+    bool uid(int tgid, uid_t &out) const;
+
+private:
+    void drain_events();
+    void resync(); // relist /proc after lost events
+    bool query_uid(int tgid, uid_t &out);
+
+    int events_fd_ = -1;    // proc connector
+    int taskstats_fd_ = -1; // generic netlink
+    unsigned short taskstats_family_ = 0;
+    unsigned int seq_ = 0;
+
+    std::unordered_set<int> live_;
+    std::unordered_set<int> stale_; // need a fresh uid lookup
+    std::unordered_map<int, uid_t> uids_;
+    std::vector<int> sorted_;
+};
+
+#endif
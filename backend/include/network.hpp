@@ -2,6 +2,7 @@
 #define NETWORK_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <nlohmann/json.hpp>
 
@@ -12,7 +13,23 @@ struct NetworkStats
     double download_rate;
 };
 
+// raw cumulative byte counters of one interface in /proc/net/dev
+struct RawNet
+{
+    std::string iface;
+    long rx_bytes;
+    long tx_bytes;
+};
+
+std::vector<RawNet> read_raw_net();
+std::vector<RawNet> parse_raw_net(std::string_view net_dev); // already loaded /proc/net/dev
+
+// bytes/sec per interface present in both readings, taken `seconds` apart
+std::vector<NetworkStats> network_rates_between(const std::vector<RawNet> &before, const std::vector<RawNet> &after, double seconds);
+
+// rates since the previous call (empty on the first call)
 std::vector<NetworkStats> get_network_rates();
 nlohmann::json network_to_json(const NetworkStats &iface);
+NetworkStats network_from_json(const nlohmann::json &j);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef PROCESS_TABLE_HPP
+#define PROCESS_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <processes.hpp>
+#include <users.hpp>
+
+// interned process name, an index into process_names()
+using NameId = std::uint32_t;
+
+// append-only string interner; ids and the returned references stay valid
+class NamePool
+{
+public:
+    NameId intern(std::string_view name);
+    const std::string &name(NameId id) const;
+
+private:
+    // keys view into names_ (a deque, so they never move): lookups take the
+    // caller's string_view as is and only inserting a new name allocates
+    std::unordered_map<std::string_view, NameId> ids_;
+    std::deque<std::string> names_;
+    mutable std::shared_mutex mutex_;
+};
+
+// process-wide pool for comm names (at most 15 chars, so the set stays small)
+NamePool &process_names();
+
+// columnar copy of one refresh's process list: ranking and filtering walk only the
+// columns they compare instead of whole ProcessInfo rows (or json objects).
+// row i corresponds to the i-th ProcessInfo the table was built from
+struct ProcessTable
+{
+    std::vector<int> pid;
+    std::vector<double> cpu_usage;      // %
+    std::vector<double> cpu_time;       // seconds
+    std::vector<long> memory_kb;        // RSS
+    std::vector<double> memory_percent; // % of MemTotal
+    std::vector<int> threads;
+    std::vector<char> state; // stat state code
+    std::vector<NameId> name;
+    std::vector<UserId> user;
+
+    std::size_t size() const { return pid.size(); }
+    void clear();
+    void reserve(std::size_t n);
+    void push_back(const ProcessInfo &p);
+    void assign(const std::vector<ProcessInfo> &processes);
+};
+
+// columns a process list can be ordered by. numeric load columns rank largest
+// first; pid and name rank ascending
+enum class ProcessSortKey
+{
+    Cpu,     // cpu%
+    Memory,  // mem%
+    Threads,
+    CpuTime,
+    Pid,
+    Name,
+};
+
+// parse "cpu", "mem", "threads", "time", "pid", "name" or a comma-separated list of
+// them ("mem,cpu"): later keys break ties of earlier ones, pid always breaks the rest
+bool parse_process_order(std::string_view spec, std::vector<ProcessSortKey> &keys, std::string *err = nullptr);
+
+// short label of a key, as accepted by parse_process_order
+const char *process_sort_key_name(ProcessSortKey key);
+
+// the first limit row indices in order. only those rows are fully sorted: the rest
+// are partitioned away with nth_element, so a frame costs O(n + limit log limit).
+// rows restricts the ranking to a subset (e.g. filter_processes), all rows when null
+std::vector<std::uint32_t> rank_processes(const ProcessTable &t, const std::vector<ProcessSortKey> &keys, std::size_t limit,
+                                          const std::vector<std::uint32_t> *rows = nullptr);
+
+// positions [offset, offset + count) of the same order, for a scrolled viewport:
+// O(n + count log count) however far down the window is
+std::vector<std::uint32_t> rank_window(const ProcessTable &t, const std::vector<ProcessSortKey> &keys, std::size_t offset, std::size_t count,
+                                       const std::vector<std::uint32_t> *rows = nullptr);
+
+// position of row in that order, counted in O(n) without sorting
+std::size_t process_rank(const ProcessTable &t, const std::vector<ProcessSortKey> &keys, std::uint32_t row,
+                         const std::vector<std::uint32_t> *rows = nullptr);
+
+// row index of pid, or t.size() if it is not in the table
+std::size_t find_process(const ProcessTable &t, int pid);
+
+// row indices whose name contains needle (all rows when needle is empty)
+std::vector<std::uint32_t> filter_processes(const ProcessTable &t, std::string_view needle);
+
+#endif
@@ -2,10 +2,19 @@
 #define PROCESSES_HPP
 
 #include <csignal>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#include <sys/types.h>
 #include <nlohmann/json.hpp>
 
+#include <netlink_procs.hpp>
+#include <procfs.hpp>
+#include <users.hpp>
+#include <worker_pool.hpp>
+
 struct CPUInfo
 {
     double cpu_usage; // % CPU used by the process (interval based)
@@ -21,16 +30,84 @@ struct ProcessInfo
     long memory_usage;     // kB (VmRSS)
     double memory_percent; // % of MemTotal
     std::string status;
+    char state = '?'; // stat state code (R, S, D, Z, T, ...)
     int threads;
-    std::string user; // username
+    UserId user = UNKNOWN_USER; // interned username, see user_name()
 };
 
-// collect all running processes on linux
+// username of a row (resolved through the shared UserCache)
+const std::string &user_name(const ProcessInfo &p);
+
+// ProcessInfo::status for a stat state code ("Running", "Sleeping", ...)
+std::string process_status_name(char state);
+
+// where the tracker gets its pid set and process owners from
+enum class ProcessBackend
+{
+    Proc,    // list /proc and parse status every refresh
+    Netlink, // proc connector events + taskstats (see netlink_procs.hpp)
+};
+
+// upper bound for collector_threads: the scan is bound by /proc reads, and past
+// a few dozen threads they only contend on the kernel's pid and task locks
+constexpr int MAX_COLLECTOR_THREADS = 64;
+
+// long-lived process collector: keeps the previous sample of every pid so
+// CPU% is computed against the last refresh instead of sleeping between two scans
+class ProcessTracker
+{
+public:
+    // collector_threads > 1 reads the per-pid files on a pool of that many threads
+    // (clamped to 1..MAX_COLLECTOR_THREADS)
+    // the netlink backend falls back to /proc when it can't be opened (unprivileged)
+    explicit ProcessTracker(int collector_threads = 1, ProcessBackend backend = ProcessBackend::Proc);
+    ~ProcessTracker();
+
+    // the backend actually in use, and why netlink was dropped if it was
+    ProcessBackend backend() const { return netlink_ ? ProcessBackend::Netlink : ProcessBackend::Proc; }
+    const std::string &backend_error() const { return backend_error_; }
+
+    // scan /proc once; CPU% is relative to the previous refresh (0 on the first)
+    std::vector<ProcessInfo> refresh();
+
+    // same, with system totals the caller already read this tick
+    // (aggregate /proc/stat jiffies, MemTotal in kB, logical cpu count)
+    std::vector<ProcessInfo> refresh(long total_jiffies, long mem_total_kb, int ncpu);
+
+private:
+    struct Sample
+    {
+        unsigned long long start_time; // jiffies after boot, tells reused pids apart
+        long jiffies;                  // utime + stime
+    };
+
+    // one worker's output for a refresh, merged once every worker is done
+    struct Shard
+    {
+        procfs::Buffer buf; // reused read buffer
+        std::vector<ProcessInfo> processes;
+        std::vector<std::pair<int, Sample>> samples;
+        std::vector<uid_t> uids;
+    };
+
+    std::unordered_map<int, Sample> prev_;
+    long prev_total_ = 0;
+    std::vector<int> pids_;
+    std::vector<Shard> shards_;
+    std::unique_ptr<WorkerPool> pool_;
+    std::unique_ptr<NetlinkProcessSource> netlink_;
+    std::string backend_error_;
+};
+
+// collect all running processes on linux (one-shot: samples twice, 500 ms apart)
 std::vector<ProcessInfo> get_all_processes();
 
 // convert process info to JSON format
 nlohmann::json process_to_json(const ProcessInfo &p);
 
+// and back; the user is interned into the shared UserCache
+ProcessInfo process_from_json(const nlohmann::json &j);
+
 // kill a process by pid, return true on success
 bool kill_process(int pid, int sig = SIGTERM, std::string *error_msg = nullptr);
 
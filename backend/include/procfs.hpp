@@ -0,0 +1,97 @@
+#ifndef PROCFS_HPP
+#define PROCFS_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// allocation-free helpers for reading and tokenizing kernel text files
+namespace procfs
+{
+    // reusable read buffer: only allocates when a file outgrows it, so a
+    // collector that keeps one around reads every tick without touching the heap
+    class Buffer
+    {
+    public:
+        explicit Buffer(size_t capacity = 4096) : data_(capacity) {}
+
+        // read the whole file at path; false if it can't be opened or is empty
+        bool load(const char *path);
+
+        // re-read an already open file from offset 0 with pread
+        bool load(int fd);
+
+        std::string_view view() const { return {data_.data(), size_}; }
+
+    private:
+        std::vector<char> data_;
+        size_t size_ = 0;
+    };
+
+    // a /proc file opened once and re-read from offset 0 on every load, so the
+    // per-tick cost is one pread instead of open/read/close
+    class File
+    {
+    public:
+        explicit File(const char *path);
+        ~File();
+
+        File(const File &) = delete;
+        File &operator=(const File &) = delete;
+
+        bool is_open() const { return fd_ >= 0; }
+
+        // re-read the whole file into buf; false if it never opened or is empty
+        bool read(Buffer &buf) const { return fd_ >= 0 && buf.load(fd_); }
+
+    private:
+        int fd_;
+    };
+
+    // parse a whole token as an integer or floating point number
+    template <typename T>
+    bool parse(std::string_view tok, T &out)
+    {
+        if (tok.empty())
+            return false;
+        auto [ptr, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), out);
+        return ec == std::errc() && ptr == tok.data() + tok.size();
+    }
+
+    // splits a view into whitespace-separated tokens and lines, without copying
+    class Tokenizer
+    {
+    public:
+        explicit Tokenizer(std::string_view s) : s_(s) {}
+
+        // next token separated by spaces, tabs or newlines; empty at the end
+        std::string_view next();
+
+        template <typename T>
+        bool next(T &out) { return parse(next(), out); }
+
+        // discard n tokens; false if the input ran out first
+        bool skip(int n);
+
+        // rest of the current line without its '\n'; empty once done()
+        std::string_view next_line();
+
+        bool done() const { return s_.empty(); }
+
+    private:
+        std::string_view s_;
+    };
+
+    // value part of the first "Key:<spaces>value" line whose key matches, or empty
+    std::string_view find_key(std::string_view text, std::string_view key);
+
+    // strip leading/trailing spaces and tabs
+    std::string_view trim(std::string_view s);
+
+    // writes "/proc/<pid>/<file>" into out (no heap); returns out
+    const char *pid_path(char (&out)[64], int pid, const char *file);
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// typed model the TUI draws from: tables describe their columns and format a
+// cell only when it is actually drawn, so nothing goes through json per frame
+namespace render
+{
+    // widths are decided by the layout once per terminal size, not from cell contents:
+    // a column is at least as wide as its title and width, and flexible columns
+    // (max_width > width) share the space left over, up to max_width
+    struct Column
+    {
+        std::string title;
+        size_t width = 6;
+        size_t max_width = 0; // 0: fixed
+        unsigned drop = 0;    // narrow terminals hide the highest ranks first; 0 always stays
+    };
+
+    struct Table
+    {
+        std::string title;
+        const std::vector<Column> *columns = nullptr; // static storage: the layout caches widths by address
+        size_t rows = 0;
+        size_t highlight = SIZE_MAX; // row drawn as selected, none by default
+
+        // append the text of (row, col) to out
+        std::function<void(size_t row, size_t col, std::string &out)> cell;
+    };
+
+    // append numbers without a stream or a temporary string (std::to_chars)
+    void append_int(std::string &out, long long v);
+    void append_fixed(std::string &out, double v, int precision);
+
+    // append the human_bytes / human_bytes_total form of v
+    void append_rate(std::string &out, double bps);
+    void append_bytes(std::string &out, double bytes);
+
+    // 4.2013 -> "4.2%"
+    std::string fmt_pct(double v);
+
+    // bps to human-readable form w/ corresponding unit!
+    // 1048576.0 -> "1.00 MB/s"
+    std::string human_bytes(double bps);
+
+    // same but byte COUNTS
+    // 8192.0 -> "8.0 KB"
+    std::string human_bytes_total(double bytes);
+}
+
+#endif
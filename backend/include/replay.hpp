@@ -0,0 +1,69 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <history.hpp>
+#include <sampler.hpp>
+
+// recorded ticks played back through the TUI in place of the live sampler.
+// a source is a --record directory or ring file, a directory of
+// buzz-snapshot-*.json / *.bin files, or a single snapshot file.
+//
+// the frames' timestamps form a sorted index, so seeking is a binary search over
+// it and never touches the recording itself; only the frame shown is decoded
+// (for a compressed ring, along with the frames since its keyframe)
+class Replay
+{
+public:
+    bool open(const std::string &path, std::string *err = nullptr);
+
+    std::size_t size() const { return times_.size(); }
+    std::size_t index() const { return index_; }
+    std::int64_t position_ns() const { return position_; }
+    std::int64_t start_ns() const { return times_.front(); }
+    std::int64_t end_ns() const { return times_.back(); }
+
+    bool playing() const { return playing_; }
+    int speed() const { return speed_; }
+    void toggle(std::chrono::steady_clock::time_point now);
+    void set_speed(int speed, std::chrono::steady_clock::time_point now);
+
+    // O(log n): the last frame at or before t (the first frame if t is earlier)
+    void seek(std::int64_t t_ns);
+    void step(long frames); // whole frames, clamped to the recording
+
+    // while playing: advance the recorded clock by the wall time since the last
+    // call times the speed; playback pauses at the end
+    void advance(std::chrono::steady_clock::time_point now);
+
+    // poll() timeout until the next frame is due, -1 when paused
+    int timeout_ms() const;
+
+    // the current frame, decoded once and cached; nullptr (with err) if unreadable
+    std::shared_ptr<const SystemSample> current(std::string *err = nullptr);
+
+private:
+    std::shared_ptr<const SystemSample> load(std::size_t i, std::string *err);
+
+    // one of the two sources is used
+    std::unique_ptr<history::HistoryReader> ring_;
+    std::vector<std::string> files_;
+    std::vector<std::int64_t> times_; // non-decreasing
+
+    std::size_t index_ = 0;
+    std::int64_t position_ = 0; // recorded time shown
+    bool playing_ = false;
+    int speed_ = 1;
+    std::chrono::steady_clock::time_point last_wall_;
+
+    std::size_t loaded_index_ = SIZE_MAX;
+    std::shared_ptr<const SystemSample> loaded_;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <battery.hpp>
+#include <collector.hpp>
+#include <cpu.hpp>
+#include <disk.hpp>
+#include <memory.hpp>
+#include <network.hpp>
+#include <process_table.hpp>
+#include <processes.hpp>
+#include <procfs.hpp>
+
+// one process scan: the rows and their columnar copy, in the same order. samples
+// share it, so a tick that doesn't rescan carries the previous scan over as is
+struct ProcessScan
+{
+    std::vector<ProcessInfo> processes;
+    ProcessTable table;
+};
+
+// everything buzz displays, captured at one tick
+struct SystemSample
+{
+    std::chrono::system_clock::time_point timestamp;
+    double interval_s = 0.0; // seconds since the previous tick, 0 on the first
+
+    // CPU
+    double cpu_usage = 0.0;
+    std::vector<double> per_core_usage;
+    long long running_processes = 0;
+    std::string cpu_name;
+    double cpu_frequency = 0.0; // MHz, mean across cores
+    std::vector<double> per_core_frequency; // MHz
+    int logical_processors = 0;
+    std::shared_ptr<const CpuTopology> topology;
+
+    // memory
+    double memory_usage = 0.0; // %
+    MemInfo memory;
+
+    std::shared_ptr<const ProcessScan> process_scan; // null when processes weren't collected
+    std::vector<DiskStats> disks;
+    std::vector<NetworkStats> network;
+    BatteryInfo battery;
+
+    // the scan's rows and table, empty without one
+    const std::vector<ProcessInfo> &processes() const;
+    const ProcessTable &process_table() const;
+
+    // a new scan of these rows, with the table built from them
+    void set_processes(std::vector<ProcessInfo> processes);
+};
+
+// builds a SystemSample per tick from a set of collectors (see collector.hpp):
+// the built-in ones minus those switched off, each run on its own interval.
+// collectors not due carry their part of the previous sample over. the
+// system-wide files are opened once and re-read with pread, at most once per
+// tick however many collectors use them; nothing sleeps, rates are derived from
+// each collector's previous run
+class Sampler
+{
+public:
+    // collector_threads and backend are passed to the process scan (see ProcessTracker);
+    // collectors switches built-in collectors off or changes their intervals
+    explicit Sampler(int collector_threads = 1, ProcessBackend backend = ProcessBackend::Proc,
+                     const CollectorConfig &collectors = {});
+    ~Sampler();
+
+    Sampler(const Sampler &) = delete;
+    Sampler &operator=(const Sampler &) = delete;
+
+    // sample now; the first tick runs every collector
+    const SystemSample &tick();
+
+    const SystemSample &latest() const { return *sample_; }
+
+    // the same sample as a shared, immutable object: every tick builds a new one,
+    // so a holder keeps seeing consistent data while later ticks run
+    std::shared_ptr<const SystemSample> shared_latest() const { return sample_; }
+
+    const ProcessTracker &process_tracker() const { return processes_; }
+
+    // plug in another source, run after the built-in ones; interval 0 runs it every tick
+    void add(std::unique_ptr<Collector> collector, std::chrono::milliseconds interval);
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<Collector> collector;
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point next; // due from then on
+        bool ran = false;
+    };
+
+    std::shared_ptr<SystemSample> sample_ = std::make_shared<SystemSample>();
+    ProcessTracker processes_;
+    TickInputs inputs_;
+    std::vector<Slot> collectors_; // in run order
+
+    bool primed_ = false;
+    std::chrono::steady_clock::time_point prev_time_;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SAMPLER_THREAD_HPP
+#define SAMPLER_THREAD_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <sampler.hpp>
+
+// runs a Sampler on its own thread every interval and publishes each sample as an
+// immutable snapshot, so the TUI keeps drawing and reading keys while /proc is scanned.
+// the first sample is published one interval after start, so its rates cover a
+// whole interval
+class SamplerThread
+{
+public:
+    SamplerThread(int collector_threads, ProcessBackend backend, std::chrono::milliseconds interval,
+                  const CollectorConfig &collectors = {});
+    ~SamplerThread(); // stops and joins the thread
+
+    // false if the eventfd couldn't be created; no thread runs then, see error()
+    bool ok() const { return event_fd_ >= 0; }
+    const std::string &error() const { return error_; }
+
+    SamplerThread(const SamplerThread &) = delete;
+    SamplerThread &operator=(const SamplerThread &) = delete;
+
+    // newest published sample, nullptr before the first; safe from any thread
+    std::shared_ptr<const SystemSample> latest() const { return std::atomic_load(&latest_); }
+
+    // eventfd that turns readable when a sample is published; drain() after waking
+    int event_fd() const { return event_fd_; }
+    void drain();
+
+    // backend choice is fixed at construction, so this is safe to read while sampling
+    const ProcessTracker &process_tracker() const { return sampler_.process_tracker(); }
+
+private:
+    void run();
+    void publish();
+
+    Sampler sampler_;
+    std::chrono::milliseconds interval_;
+    std::shared_ptr<const SystemSample> latest_;
+    int event_fd_ = -1;
+    std::string error_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_; // started once everything above is set up
+};
+
+// headless modes (--stream, --record): run a SamplerThread until SIGINT/SIGTERM or
+// until on_sample returns false, handing on_sample every sample. false (with err)
+// only if the signals or the sampler thread can't be set up
+bool run_until_signal(int collector_threads, ProcessBackend backend, std::chrono::milliseconds interval,
+                      const CollectorConfig &collectors, const std::function<bool(const SystemSample &)> &on_sample,
+                      std::string *err = nullptr);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SCREEN_HPP
+#define SCREEN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+// off-screen frame for the TUI. A frame is composed into a grid of cells,
+// and flush() emits only the runs that differ from the previous frame:
+// cursor moves, style changes and text, all in a single write()
+class Screen
+{
+public:
+    enum Style : std::uint8_t
+    {
+        Normal,
+        Dim,
+        Header, // cyan
+        Title,  // magenta
+        Ok,     // green
+        Warn,   // yellow
+        Err,    // red
+        Selected, // reverse video
+    };
+
+    explicit Screen(int fd = STDOUT_FILENO, bool color = true);
+
+    // terminal size; a change forces a full redraw on the next flush
+    void resize(int rows, int cols);
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+    // start composing a new frame: blank grid, cursor at the top-left
+    void clear();
+
+    // text at the cursor; clipped at the right edge, '\n' moves to the next row
+    void print(std::string_view text, Style style = Normal);
+    void fill(char ch, int count, Style style = Normal);
+    void move(int row, int col);
+    int row() const { return row_; }
+    int col() const { return col_; }
+
+    // write what changed since the last flush and leave the terminal cursor at
+    // the compose cursor; returns the bytes written. a failed or short write makes
+    // the next flush a full redraw
+    size_t flush();
+
+    // output of flush(): bytes and write(2) calls
+    struct Stats
+    {
+        size_t bytes = 0;
+        size_t writes = 0;
+    };
+    const Stats &last_frame() const { return last_; }
+    const Stats &total() const { return total_; }
+
+    // the terminal no longer shows the last frame (something else wrote to it);
+    // the next flush clears it and redraws everything
+    void invalidate() { full_ = true; }
+
+private:
+    struct Cell
+    {
+        char ch = ' ';
+        Style style = Normal;
+
+        bool operator==(const Cell &o) const { return ch == o.ch && style == o.style; }
+        bool operator!=(const Cell &o) const { return !(*this == o); }
+    };
+
+    void put(char ch, Style style);
+
+    int fd_;
+    bool color_;
+    int rows_ = 0;
+    int cols_ = 0;
+    int row_ = 0;
+    int col_ = 0;
+    bool full_ = true;
+    std::vector<Cell> back_;  // frame being composed
+    std::vector<Cell> front_; // what the terminal shows
+    std::string out_;         // reused escape/text buffer, reserved for a full redraw
+    std::vector<std::string> row_esc_; // "\033[<row>;" per row
+    std::vector<std::string> col_esc_; // "<col>H" per column
+    Stats last_;
+    Stats total_;
+};
+
+#endif
@@ -2,16 +2,48 @@
 #define SNAPSHOT_HPP
 
 #include <string>
+#include <string_view>
 #include <nlohmann/json.hpp>
 
+#include <sampler.hpp>
+
 namespace snapshot
 {
+    // top-level parts of a snapshot, as a bitmask; "timestamp" is always present
+    enum Section : unsigned
+    {
+        Cpu = 1u << 0,       // "cpu" totals
+        Cores = 1u << 1,     // "cpu.per_core_usage"
+        Topology = 1u << 2,  // "cpu.topology", constant for the life of the process
+        Memory = 1u << 3,    // "memory"
+        Processes = 1u << 4, // "process_info", the bulk of a snapshot
+        Disk = 1u << 5,      // "disk"
+        Network = 1u << 6,   // "network"
+        Battery = 1u << 7,   // "battery"
+        All = (1u << 8) - 1,
+    };
+
+    // parse a comma-separated list of "cpu", "cores", "topology", "memory",
+    // "processes", "disk", "network", "battery" or "all" into a Section mask
+    bool parse_sections(std::string_view spec, unsigned &sections, std::string *err = nullptr);
+
     // structure mirrors the output of src/main.cpp:
     nlohmann::json make();
 
+    // same layout, built from a sample the caller already took; only the
+    // requested sections are serialized
+    nlohmann::json to_json(const SystemSample &s, unsigned sections = All);
+
+    // rebuild a sample from the to_json() layout (all sections, as make() writes);
+    // the process table is rebuilt and names/users interned again
+    bool from_json(const nlohmann::json &j, SystemSample &s, std::string *err = nullptr);
+
+    // "2025-01-01T12:30:45Z", as in the "timestamp" field
+    std::string format_timestamp(std::chrono::system_clock::time_point tp);
+
     // generate a default filename for saving the snapshot
     // eg: buzz-snapshot-20250101-123045Z.json
-    std::string default_filename();
+    std::string default_filename(const char *ext = ".json");
 
     bool save_to_file(const nlohmann::json &j, const std::string &path, std::string *err = nullptr);
 }
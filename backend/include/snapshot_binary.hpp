@@ -0,0 +1,221 @@
+#ifndef SNAPSHOT_BINARY_HPP
+#define SNAPSHOT_BINARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <sys/uio.h>
+
+#include <sampler.hpp>
+
+// binary snapshot: the same content as the JSON snapshot, laid out so a reader
+// can mmap the file and use it in place.
+//
+//   Header | ColumnEntry[column_count] | column data ...
+//
+// every column is a packed array of one fixed-width type, starting on an 8 byte
+// boundary, so the reader hands out typed pointers into the mapping without
+// parsing or copying. strings (names, users, devices, ...) live once each in a
+// string table and rows hold a uint32_t index into it. numbers are in host byte
+// order; the endian tag rejects files from a host with the other order.
+// readers skip column ids they don't know; an incompatible layout bumps VERSION
+namespace snapshot
+{
+    constexpr char BINARY_MAGIC[8] = {'B', 'U', 'Z', 'Z', 'S', 'N', 'A', 'P'};
+    constexpr std::uint32_t BINARY_VERSION = 1;
+    constexpr std::uint32_t BINARY_ENDIAN = 0x01020304;
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t endian;
+        std::uint64_t file_size;
+        std::uint32_t column_count;
+        std::uint32_t header_size; // sizeof(Header), entries follow it
+    };
+
+    struct ColumnEntry
+    {
+        std::uint32_t id;        // ColumnId
+        std::uint32_t elem_size; // bytes per element, checked against the reader's type
+        std::uint64_t count;
+        std::uint64_t offset; // from the start of the file, 8 byte aligned
+    };
+
+    // where a string sits in the StringData column
+    struct StringRef
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+    };
+
+    // the one-per-snapshot scalars
+    struct SystemRecord
+    {
+        std::int64_t timestamp_ns; // system clock, since the epoch
+        double interval_s;
+        double cpu_usage;
+        double cpu_frequency;
+        std::int64_t running_processes;
+        double memory_usage;
+        std::int32_t logical_processors;
+        std::uint32_t cpu_name; // string index
+        std::uint32_t battery_status; // string index
+        std::int32_t battery_charge;
+        std::int32_t has_topology;
+        std::int32_t physical_cores;
+        std::int32_t sockets;
+        std::int32_t numa_nodes;
+        std::int32_t threads_per_core;
+        std::uint32_t reserved;
+    };
+
+    enum class ColumnId : std::uint32_t
+    {
+        System = 1,     // SystemRecord[1]
+        StringRefs,     // StringRef[]
+        StringData,     // char[]
+        CoreUsage,      // double[] %
+        CoreFrequency,  // double[] MHz
+        CacheLevel,     // int32_t[]
+        CacheType,      // uint32_t[] string index
+        CacheSizeKb,    // int64_t[]
+        MemInfo,        // int64_t[] in MEMINFO_FIELDS order
+
+        ProcPid = 16,      // int32_t[]
+        ProcCpuUsage,      // double[]
+        ProcCpuTime,       // double[]
+        ProcMemoryKb,      // int64_t[]
+        ProcMemoryPercent, // double[]
+        ProcThreads,       // int32_t[]
+        ProcState,         // char[]
+        ProcName,          // uint32_t[] string index
+        ProcUser,          // uint32_t[] string index
+        ProcType,          // uint32_t[] string index
+        ProcStatus,        // uint32_t[] string index
+
+        DiskDevice = 32,    // uint32_t[] string index
+        DiskReads,          // int64_t[]
+        DiskWrites,         // int64_t[]
+        DiskSectorsRead,    // int64_t[]
+        DiskSectorsWritten, // int64_t[]
+        DiskReadMs,         // double[]
+        DiskWriteMs,        // double[]
+        DiskReadRate,       // double[]
+        DiskWriteRate,      // double[]
+
+        NetInterface = 48, // uint32_t[] string index
+        NetUpload,         // double[]
+        NetDownload,       // double[]
+
+        Max = 64, // ids stay below this
+    };
+
+    // read-only view of one column inside a mapping
+    template <class T>
+    struct Span
+    {
+        const T *data = nullptr;
+        std::size_t size = 0;
+
+        const T &operator[](std::size_t i) const { return data[i]; }
+        const T *begin() const { return data; }
+        const T *end() const { return data + size; }
+        bool empty() const { return size == 0; }
+    };
+
+    // a sample serialized as iovecs, ready for one writev (or a copy into a
+    // mapping). numeric process columns point straight into the sample's
+    // ProcessTable, so the sample must outlive the image
+    class BinaryImage
+    {
+    public:
+        void encode(const SystemSample &s);
+
+        const std::vector<iovec> &iov() const { return iov_; }
+        std::size_t size() const { return size_; }
+
+        // gather the image into dst, which holds at least size() bytes
+        void copy_to(void *dst) const;
+
+    private:
+        std::uint32_t intern(std::string_view str);
+        template <class T>
+        void column(ColumnId id, const T *data, std::size_t count);
+        template <class T>
+        T *alloc(ColumnId id, std::size_t count); // column stored in the image
+
+        std::vector<iovec> iov_;
+        std::size_t size_ = 0;
+        Header header_{};
+        SystemRecord system_{};
+        std::vector<ColumnEntry> entries_;
+        std::vector<const void *> data_; // per entry
+
+        // storage for columns that are not already laid out in the sample; kept
+        // between encodes so a long recording stops allocating
+        std::vector<std::vector<char>> owned_;
+        std::size_t owned_used_ = 0;
+        std::string strings_;
+        std::vector<StringRef> refs_;
+        std::unordered_map<std::string_view, std::uint32_t> string_ids_; // views into the sample
+        std::vector<std::uint32_t> name_ids_, user_ids_;                  // NameId/UserId -> string index
+    };
+
+    // a binary snapshot read in place: from a file (mmap) or memory the caller owns
+    class BinarySnapshot
+    {
+    public:
+        BinarySnapshot() = default;
+        ~BinarySnapshot();
+
+        BinarySnapshot(const BinarySnapshot &) = delete;
+        BinarySnapshot &operator=(const BinarySnapshot &) = delete;
+
+        bool open(const std::string &path, std::string *err = nullptr);
+
+        // data must stay valid and unchanged while the view is used
+        bool attach(const void *data, std::size_t size, std::string *err = nullptr);
+
+        const SystemRecord &system() const { return *system_; }
+
+        // empty when the column is missing or its element size doesn't match T
+        template <class T>
+        Span<T> column(ColumnId id) const
+        {
+            const ColumnEntry *e = entries_[static_cast<std::uint32_t>(id)];
+            if (!e || e->elem_size != sizeof(T))
+                return {};
+            return {reinterpret_cast<const T *>(base_ + e->offset), static_cast<std::size_t>(e->count)};
+        }
+
+        // "" for an index outside the string table
+        std::string_view string(std::uint32_t index) const;
+
+    private:
+        void unmap();
+
+        const char *base_ = nullptr;
+        std::size_t size_ = 0;
+        void *map_ = nullptr; // set when open() mapped a file
+        const ColumnEntry *entries_[static_cast<std::uint32_t>(ColumnId::Max)] = {};
+        const SystemRecord *system_ = nullptr;
+        Span<StringRef> refs_;
+        Span<char> chars_;
+    };
+
+    // write s as a binary snapshot with a single writev
+    bool save_binary(const SystemSample &s, const std::string &path, std::string *err = nullptr);
+
+    // rebuild a sample from a binary snapshot (names and users are interned again)
+    bool to_sample(const BinarySnapshot &b, SystemSample &s, std::string *err = nullptr);
+
+    // binary -> indented JSON or JSON -> binary, picked by the input's magic
+    bool convert_file(const std::string &in, const std::string &out, std::string *err = nullptr);
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <chrono>
+#include <string>
+
+#include <snapshot.hpp>
+
+struct StreamOptions
+{
+    std::string path;                     // file or FIFO appended to; empty or "-" for stdout
+    unsigned sections = snapshot::All;    // see snapshot::parse_sections
+    std::chrono::milliseconds interval{2000};
+    int collector_threads = 1;
+    ProcessBackend process_backend = ProcessBackend::Proc;
+    CollectorConfig collectors; // see parse_collectors
+};
+
+namespace stream
+{
+    // write one compact JSON snapshot per line (NDJSON) every interval until
+    // SIGINT/SIGTERM or the reader goes away. one sampler lives for the whole
+    // run, so every line's rates cover exactly the time since the line before.
+    // returns the process exit code
+    int run(const StreamOptions &opts);
+}
+
+#endif
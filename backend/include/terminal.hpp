@@ -0,0 +1,66 @@
+#ifndef TERMINAL_HPP
+#define TERMINAL_HPP
+
+#include <string>
+#include <vector>
+#include <termios.h>
+#include <unistd.h>
+
+// puts a tty into non-canonical, no-echo mode so keys arrive one at a time, and
+// restores the saved settings on destruction. ISIG stays on: Ctrl-C still raises SIGINT
+class RawTerminal
+{
+public:
+    explicit RawTerminal(int fd = STDIN_FILENO);
+    ~RawTerminal();
+
+    RawTerminal(const RawTerminal &) = delete;
+    RawTerminal &operator=(const RawTerminal &) = delete;
+
+    // false when fd is not a tty (input is then read as plain bytes)
+    bool active() const { return active_; }
+
+private:
+    int fd_;
+    bool active_ = false;
+    termios saved_{};
+};
+
+struct Key
+{
+    enum Code
+    {
+        None,
+        Char, // printable byte in ch
+        Enter,
+        Escape,
+        Backspace,
+        Tab,
+        Up,
+        Down,
+        Left,
+        Right,
+        PageUp,
+        PageDown,
+        Home,
+        End,
+        Delete,
+    };
+
+    Code code = None;
+    char ch = 0;
+};
+
+// turns input bytes into keys; an escape sequence split across reads is kept
+// until the rest arrives. A lone ESC at the end of a read is taken as the Escape
+// key: terminals send a whole sequence in one write
+class KeyDecoder
+{
+public:
+    void feed(const char *data, size_t n, std::vector<Key> &out);
+
+private:
+    std::string pending_;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef USERS_HPP
+#define USERS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+
+// interned username: an index into UserCache's name table, stable for the
+// life of the process, so rows carry 4 bytes instead of a std::string copy
+using UserId = std::uint32_t;
+
+// "unknown", interned by every UserCache before any other name, so rows whose
+// user was never set do not borrow a real user's name
+constexpr UserId UNKNOWN_USER = 0;
+
+// uid -> name cache shared by every refresh, so NSS (sssd/LDAP) is asked once
+// per uid instead of once per process per frame. Misses are cached as "unknown"
+// too. Entries are dropped when /etc/passwd changes (inotify) or after ttl,
+// which covers NSS sources that never touch /etc/passwd
+class UserCache
+{
+public:
+    explicit UserCache(std::chrono::seconds ttl = std::chrono::minutes(10));
+    ~UserCache();
+
+    UserCache(const UserCache &) = delete;
+    UserCache &operator=(const UserCache &) = delete;
+
+    // call once per refresh before lookups: applies /etc/passwd changes and the ttl
+    void revalidate();
+
+    UserId lookup(uid_t uid);
+
+    // safe to call from any thread; the reference stays valid
+    const std::string &name(UserId id) const;
+
+    // id of a name that did not come from a uid (e.g. a loaded snapshot)
+    UserId intern(const std::string &name);
+
+private:
+
+    struct Entry
+    {
+        UserId id;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    std::chrono::seconds ttl_;
+    int inotify_fd_ = -1;
+    std::unordered_map<uid_t, Entry> by_uid_;
+    std::unordered_map<std::string, UserId> ids_;
+    std::deque<std::string> names_; // deque: push_back keeps references valid
+    mutable std::shared_mutex names_mutex_;
+};
+
+// process-wide cache used by the process collectors
+UserCache &user_cache();
+
+#endif
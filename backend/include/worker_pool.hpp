@@ -0,0 +1,40 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of long-lived threads that all run the same job together;
+// the calling thread takes part as worker 0, so a pool of 1 spawns nothing
+class WorkerPool
+{
+public:
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    int size() const { return static_cast<int>(threads_.size()) + 1; }
+
+    // run job(worker_index) once on every worker and wait for all of them
+    void run(const std::function<void(int)> &job);
+
+private:
+    void loop(int index);
+    void stop(); // wake and join every thread
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(int)> *job_ = nullptr;
+    unsigned long generation_ = 0;
+    int pending_ = 0;
+    bool stop_ = false;
+};
+
+#endif
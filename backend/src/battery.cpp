@@ -42,3 +42,11 @@ json battery_to_json(const BatteryInfo &b)
         {"current_capacity", b.current_charge},
     };
 }
+
+BatteryInfo battery_from_json(const json &j)
+{
+    BatteryInfo b;
+    b.status = j.value("status", std::string());
+    b.current_charge = j.value("current_capacity", 0);
+    return b;
+}
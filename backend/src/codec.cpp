@@ -0,0 +1,647 @@
+#include "codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <users.hpp>
+
+namespace codec
+{
+    // first byte of a frame: format version in the high nibble, flags below
+    constexpr unsigned FRAME_VERSION = 0x10;
+    constexpr unsigned FRAME_KEY = 0x01;
+
+    static std::uint64_t mask(int n) { return n >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << n) - 1; }
+
+    static std::uint64_t zigzag(std::int64_t v)
+    {
+        return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+    }
+
+    static std::int64_t unzigzag(std::uint64_t v)
+    {
+        return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+    }
+
+    // most significant bit first, appended to a string 8 bytes at a time
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::string &out) : out_(out) {}
+
+        // the low n bits of v, n <= 64
+        void put(std::uint64_t v, int n)
+        {
+            while (n > 0)
+            {
+                int take = std::min(n, 64 - used_);
+                acc_ |= ((v >> (n - take)) & mask(take)) << (64 - used_ - take);
+                used_ += take;
+                n -= take;
+                if (used_ == 64)
+                    spill(8);
+            }
+        }
+
+        void bit(bool b) { put(b ? 1 : 0, 1); }
+
+        void uvarint(std::uint64_t v)
+        {
+            for (; v >= 0x80; v >>= 7)
+                put((v & 0x7f) | 0x80, 8);
+            put(v, 8);
+        }
+
+        // pad the last byte with zeros
+        void flush() { spill((used_ + 7) / 8); }
+
+    private:
+        void spill(int bytes)
+        {
+            char b[8];
+            for (int i = 0; i < bytes; ++i)
+                b[i] = static_cast<char>(acc_ >> (56 - 8 * i));
+            out_.append(b, static_cast<std::size_t>(bytes));
+            acc_ = 0;
+            used_ = 0;
+        }
+
+        std::string &out_;
+        std::uint64_t acc_ = 0;
+        int used_ = 0;
+    };
+
+    // reading past the end yields zeros and marks the reader bad
+    class BitReader
+    {
+    public:
+        BitReader(const char *data, std::size_t size)
+            : p_(reinterpret_cast<const unsigned char *>(data)), end_(p_ + size) {}
+
+        std::uint64_t get(int n)
+        {
+            std::uint64_t v = 0;
+            while (n > 0)
+            {
+                if (avail_ == 0 && !refill())
+                {
+                    bad_ = true;
+                    return 0;
+                }
+                int take = std::min(n, avail_);
+                std::uint64_t chunk = (acc_ >> (avail_ - take)) & mask(take);
+                v = take == 64 ? chunk : (v << take) | chunk;
+                avail_ -= take;
+                n -= take;
+            }
+            return v;
+        }
+
+        bool bit() { return get(1) != 0; }
+
+        std::uint64_t uvarint()
+        {
+            std::uint64_t v = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                std::uint64_t b = get(8);
+                v |= (b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    return v;
+            }
+            bad_ = true;
+            return 0;
+        }
+
+        // a count of things that each take at least a bit: anything larger is corrupt
+        std::size_t count()
+        {
+            std::uint64_t n = uvarint();
+            if (n > static_cast<std::uint64_t>(end_ - p_) * 8 + static_cast<std::uint64_t>(avail_))
+            {
+                bad_ = true;
+                return 0;
+            }
+            return static_cast<std::size_t>(n);
+        }
+
+        void fail() { bad_ = true; }
+        bool bad() const { return bad_; }
+
+    private:
+        bool refill()
+        {
+            acc_ = 0;
+            int n = 0;
+            for (; n < 8 && p_ < end_; ++n)
+                acc_ = (acc_ << 8) | *p_++;
+            avail_ = 8 * n;
+            return n > 0;
+        }
+
+        const unsigned char *p_;
+        const unsigned char *end_;
+        std::uint64_t acc_ = 0;
+        int avail_ = 0;
+        bool bad_ = false;
+    };
+
+    // ---- values ----
+
+    static void put_int(BitWriter &w, std::int64_t v, std::int64_t &prev)
+    {
+        std::uint64_t delta = static_cast<std::uint64_t>(v) - static_cast<std::uint64_t>(prev);
+        prev = v;
+        w.bit(delta != 0);
+        if (delta != 0)
+            w.uvarint(zigzag(static_cast<std::int64_t>(delta)));
+    }
+
+    static std::int64_t get_int(BitReader &r, std::int64_t &prev)
+    {
+        if (r.bit())
+            prev = static_cast<std::int64_t>(static_cast<std::uint64_t>(prev) +
+                                             static_cast<std::uint64_t>(unzigzag(r.uvarint())));
+        return prev;
+    }
+
+    //  0                     same value
+    //  10 <bits>             XOR fits the previous window
+    //  11 <5: lead> <6: len - 1> <len bits>   new window
+    static void put_double(BitWriter &w, double v, DoubleSeries &s)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        std::uint64_t x = bits ^ s.prev;
+        s.prev = bits;
+        if (x == 0)
+        {
+            w.bit(false);
+            return;
+        }
+        int lead = std::min(__builtin_clzll(x), 31);
+        int trail = __builtin_ctzll(x);
+        if (s.lead >= 0 && lead >= s.lead && trail >= s.trail)
+        {
+            w.put(0b10, 2);
+            w.put(x >> s.trail, 64 - s.lead - s.trail);
+            return;
+        }
+        int len = 64 - lead - trail;
+        w.put(0b11, 2);
+        w.put(static_cast<std::uint64_t>(lead), 5);
+        w.put(static_cast<std::uint64_t>(len - 1), 6);
+        w.put(x >> trail, len);
+        s.lead = lead;
+        s.trail = trail;
+    }
+
+    static double get_double(BitReader &r, DoubleSeries &s)
+    {
+        if (r.bit())
+        {
+            if (!r.bit())
+            {
+                if (s.lead < 0)
+                    r.fail();
+                else
+                    s.prev ^= r.get(64 - s.lead - s.trail) << s.trail;
+            }
+            else
+            {
+                int lead = static_cast<int>(r.get(5));
+                int len = static_cast<int>(r.get(6)) + 1;
+                int trail = 64 - lead - len;
+                if (trail < 0)
+                    r.fail();
+                else
+                {
+                    s.prev ^= r.get(len) << trail;
+                    s.lead = lead;
+                    s.trail = trail;
+                }
+            }
+        }
+        double v;
+        std::memcpy(&v, &s.prev, sizeof(v));
+        return v;
+    }
+
+    static void put_doubles(BitWriter &w, const std::vector<double> &values, std::vector<DoubleSeries> &series)
+    {
+        w.uvarint(values.size());
+        series.resize(values.size());
+        for (std::size_t i = 0; i < values.size(); ++i)
+            put_double(w, values[i], series[i]);
+    }
+
+    static void get_doubles(BitReader &r, std::vector<double> &values, std::vector<DoubleSeries> &series)
+    {
+        values.resize(r.count());
+        series.resize(values.size());
+        for (std::size_t i = 0; i < values.size(); ++i)
+            values[i] = get_double(r, series[i]);
+    }
+
+    void State::reset()
+    {
+        *this = State();
+    }
+
+    bool is_keyframe(const char *data, std::size_t size)
+    {
+        if (size == 0)
+            return false;
+        unsigned flags = static_cast<unsigned char>(data[0]);
+        return (flags & 0xf0) == FRAME_VERSION && (flags & FRAME_KEY);
+    }
+
+    // ---- encoder ----
+
+    // a dictionary reference; an id one past the end introduces a new string
+    void Encoder::put_string(BitWriter &w, const std::string &str, std::uint32_t &id)
+    {
+        auto it = ids_.find(str);
+        if (it != ids_.end())
+        {
+            id = it->second;
+            w.uvarint(id);
+            return;
+        }
+        id = static_cast<std::uint32_t>(state_.strings.size());
+        w.uvarint(id);
+        w.uvarint(str.size());
+        for (unsigned char c : str)
+            w.put(c, 8);
+        state_.strings.push_back(str);
+        ids_.emplace(str, id);
+    }
+
+    // a string that usually repeats the previous frame's: a 0 bit when it does
+    void Encoder::put_field(BitWriter &w, const std::string &str, std::uint32_t &id)
+    {
+        bool same = id != NO_ID && state_.strings[id] == str;
+        w.bit(!same);
+        if (!same)
+            put_string(w, str, id);
+    }
+
+    void Encoder::put_processes(BitWriter &w, const std::vector<ProcessInfo> &processes)
+    {
+        // both frames are normally in pid order (ProcessTracker sorts), so a merge
+        // walk pairs the rows; out of order input only codes worse, never wrong
+        const std::vector<State::Row> &prev = state_.rows;
+        w.uvarint(processes.size());
+        next_rows_.clear();
+        std::size_t j = 0; // first row of prev not yet passed
+        std::int64_t last_pid = 0;
+        for (const ProcessInfo &p : processes)
+        {
+            bool expected = j < prev.size() && prev[j].pid == p.pid;
+            w.bit(!expected);
+            if (!expected)
+            {
+                w.uvarint(zigzag(p.pid - last_pid));
+                while (j < prev.size() && prev[j].pid < p.pid)
+                    ++j;
+            }
+            last_pid = p.pid;
+            bool known = j < prev.size() && prev[j].pid == p.pid;
+            State::Row r = known ? prev[j++] : State::Row{};
+            r.pid = p.pid;
+
+            if (p.user >= users_.size())
+                users_.resize(p.user + 1, NO_ID);
+            std::uint32_t &user = users_[p.user];
+            bool same = known && user == r.user && state_.strings[r.name] == p.process_name &&
+                        state_.strings[r.type] == p.type;
+            if (known)
+                w.bit(!same);
+            if (!same)
+            {
+                put_string(w, p.process_name, r.name);
+                put_string(w, user_name(p), r.user);
+                put_string(w, p.type, r.type);
+                user = r.user;
+            }
+
+            same = known && r.state == p.state && state_.strings[r.status] == p.status;
+            if (known)
+                w.bit(!same);
+            if (!same)
+            {
+                w.put(static_cast<unsigned char>(p.state), 8);
+                put_string(w, p.status, r.status);
+                r.state = p.state;
+            }
+
+            put_double(w, p.cpu.cpu_usage, r.cpu_usage);
+            put_double(w, p.cpu.cpu_time, r.cpu_time);
+            put_double(w, p.memory_percent, r.memory_percent);
+            put_int(w, p.memory_usage, r.memory_kb);
+            put_int(w, p.threads, r.threads);
+            next_rows_.push_back(r);
+        }
+        state_.rows.swap(next_rows_);
+    }
+
+    void Encoder::encode(const SystemSample &s, bool keyframe, std::string &out)
+    {
+        if (keyframe || !state_.primed)
+        {
+            keyframe = true;
+            state_.reset();
+            ids_.clear();
+            users_.clear();
+        }
+        BitWriter w(out);
+        w.put(FRAME_VERSION | (keyframe ? FRAME_KEY : 0), 8);
+
+        std::int64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(s.timestamp.time_since_epoch()).count();
+        put_int(w, t - state_.timestamp, state_.timestamp_delta);
+        state_.timestamp = t;
+
+        put_double(w, s.interval_s, state_.interval);
+        put_double(w, s.cpu_usage, state_.cpu_usage);
+        put_double(w, s.cpu_frequency, state_.cpu_frequency);
+        put_double(w, s.memory_usage, state_.memory_usage);
+        put_int(w, s.running_processes, state_.running_processes);
+        put_int(w, s.logical_processors, state_.logical_processors);
+        put_int(w, s.battery.current_charge, state_.battery_charge);
+        put_field(w, s.cpu_name, state_.cpu_name);
+        put_field(w, s.battery.status, state_.battery_status);
+        put_doubles(w, s.per_core_usage, state_.core_usage);
+        put_doubles(w, s.per_core_frequency, state_.core_frequency);
+
+        // the sampler shares one topology object until a hotplug replaces it;
+        // the same fields as a binary snapshot keeps
+        bool same = state_.primed && s.topology == state_.topology;
+        w.bit(!same);
+        if (!same)
+        {
+            w.bit(s.topology != nullptr);
+            if (s.topology)
+            {
+                const CpuTopology &topo = *s.topology;
+                w.uvarint(zigzag(topo.physical_cores));
+                w.uvarint(zigzag(topo.sockets));
+                w.uvarint(zigzag(topo.numa_nodes));
+                w.uvarint(zigzag(topo.threads_per_core));
+                w.uvarint(topo.caches.size());
+                for (const CpuCache &c : topo.caches)
+                {
+                    std::uint32_t id;
+                    w.uvarint(zigzag(c.level));
+                    put_string(w, c.type, id);
+                    w.uvarint(zigzag(c.size_kb));
+                }
+            }
+            state_.topology = s.topology;
+        }
+
+        for (std::size_t i = 0; i < MEMINFO_FIELD_COUNT; ++i)
+            put_int(w, s.memory.*MEMINFO_FIELDS[i].member, state_.meminfo[i]);
+
+        put_processes(w, s.processes());
+
+        w.uvarint(s.disks.size());
+        state_.disks.resize(s.disks.size());
+        for (std::size_t i = 0; i < s.disks.size(); ++i)
+        {
+            const DiskStats &d = s.disks[i];
+            State::Device &dev = state_.disks[i];
+            put_field(w, d.device, dev.name);
+            put_int(w, d.reads_completed, dev.counters[0]);
+            put_int(w, d.writes_completed, dev.counters[1]);
+            put_int(w, d.sectors_read, dev.counters[2]);
+            put_int(w, d.sectors_written, dev.counters[3]);
+            put_double(w, d.read_time_ms, dev.values[0]);
+            put_double(w, d.write_time_ms, dev.values[1]);
+            put_double(w, d.read_rate, dev.values[2]);
+            put_double(w, d.write_rate, dev.values[3]);
+        }
+
+        w.uvarint(s.network.size());
+        state_.interfaces.resize(s.network.size());
+        for (std::size_t i = 0; i < s.network.size(); ++i)
+        {
+            State::Device &dev = state_.interfaces[i];
+            put_field(w, s.network[i].interface, dev.name);
+            put_double(w, s.network[i].upload_rate, dev.values[0]);
+            put_double(w, s.network[i].download_rate, dev.values[1]);
+        }
+
+        w.flush();
+        state_.primed = true;
+    }
+
+    // ---- decoder ----
+
+    bool Decoder::get_string(BitReader &r, std::uint32_t &id)
+    {
+        std::uint64_t v = r.uvarint();
+        if (v < state_.strings.size())
+        {
+            id = static_cast<std::uint32_t>(v);
+            return true;
+        }
+        if (v != state_.strings.size())
+            return false;
+        std::string str(r.count(), '\0');
+        for (char &c : str)
+            c = static_cast<char>(r.get(8));
+        id = static_cast<std::uint32_t>(v);
+        state_.strings.push_back(std::move(str));
+        return !r.bad();
+    }
+
+    bool Decoder::get_field(BitReader &r, std::uint32_t &id)
+    {
+        if (r.bit())
+            return get_string(r, id);
+        return id != NO_ID;
+    }
+
+    bool Decoder::get_processes(BitReader &r, std::vector<ProcessInfo> &processes)
+    {
+        const std::vector<State::Row> &prev = state_.rows;
+        processes.resize(r.count());
+        next_rows_.clear();
+        next_rows_.reserve(processes.size());
+        std::size_t j = 0;
+        std::int64_t last_pid = 0;
+        for (ProcessInfo &p : processes)
+        {
+            std::int64_t pid;
+            if (!r.bit())
+            {
+                if (j >= prev.size())
+                    return false;
+                pid = prev[j].pid;
+            }
+            else
+            {
+                pid = last_pid + unzigzag(r.uvarint());
+                while (j < prev.size() && prev[j].pid < pid)
+                    ++j;
+            }
+            last_pid = pid;
+            bool known = j < prev.size() && prev[j].pid == pid;
+            State::Row row = known ? prev[j++] : State::Row{};
+            row.pid = static_cast<int>(pid);
+
+            if (!known || r.bit())
+            {
+                if (!get_string(r, row.name) || !get_string(r, row.user) || !get_string(r, row.type))
+                    return false;
+            }
+            if (!known || r.bit())
+            {
+                row.state = static_cast<char>(r.get(8));
+                if (!get_string(r, row.status))
+                    return false;
+            }
+
+            p.pid = row.pid;
+            p.cpu.cpu_usage = get_double(r, row.cpu_usage);
+            p.cpu.cpu_time = get_double(r, row.cpu_time);
+            p.memory_percent = get_double(r, row.memory_percent);
+            p.memory_usage = static_cast<long>(get_int(r, row.memory_kb));
+            p.threads = static_cast<int>(get_int(r, row.threads));
+            p.process_name = state_.strings[row.name];
+            p.type = state_.strings[row.type];
+            p.status = state_.strings[row.status];
+            p.state = row.state;
+
+            // users repeat a lot; intern each distinct one once
+            if (row.user >= users_.size())
+                users_.resize(state_.strings.size(), static_cast<UserId>(NO_ID));
+            if (users_[row.user] == static_cast<UserId>(NO_ID))
+                users_[row.user] = user_cache().intern(state_.strings[row.user]);
+            p.user = users_[row.user];
+            next_rows_.push_back(row);
+        }
+        state_.rows.swap(next_rows_);
+        return !r.bad();
+    }
+
+    bool Decoder::decode(const char *data, std::size_t size, SystemSample &out, std::string *err)
+    {
+        auto fail = [&](const char *why)
+        {
+            if (err)
+                *err = std::string("compressed sample: ") + why;
+            state_.reset(); // what follows can't be decoded either
+            users_.clear();
+            return false;
+        };
+
+        BitReader r(data, size);
+        unsigned flags = static_cast<unsigned>(r.get(8));
+        if (r.bad() || (flags & 0xf0) != FRAME_VERSION)
+            return fail("unsupported frame format");
+        if (flags & FRAME_KEY)
+        {
+            state_.reset();
+            users_.clear();
+        }
+        else if (!state_.primed)
+        {
+            return fail("delta frame without the frames before it");
+        }
+
+        state_.timestamp += get_int(r, state_.timestamp_delta);
+        out.timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(state_.timestamp)));
+
+        out.interval_s = get_double(r, state_.interval);
+        out.cpu_usage = get_double(r, state_.cpu_usage);
+        out.cpu_frequency = get_double(r, state_.cpu_frequency);
+        out.memory_usage = get_double(r, state_.memory_usage);
+        out.running_processes = get_int(r, state_.running_processes);
+        out.logical_processors = static_cast<int>(get_int(r, state_.logical_processors));
+        out.battery.current_charge = static_cast<int>(get_int(r, state_.battery_charge));
+        if (!get_field(r, state_.cpu_name) || !get_field(r, state_.battery_status))
+            return fail("bad string reference");
+        out.cpu_name = state_.strings[state_.cpu_name];
+        out.battery.status = state_.strings[state_.battery_status];
+        get_doubles(r, out.per_core_usage, state_.core_usage);
+        get_doubles(r, out.per_core_frequency, state_.core_frequency);
+
+        if (r.bit())
+        {
+            state_.topology = nullptr;
+            if (r.bit())
+            {
+                auto topo = std::make_shared<CpuTopology>();
+                topo->model_name = out.cpu_name;
+                topo->logical_cpus = out.logical_processors;
+                topo->physical_cores = static_cast<int>(unzigzag(r.uvarint()));
+                topo->sockets = static_cast<int>(unzigzag(r.uvarint()));
+                topo->numa_nodes = static_cast<int>(unzigzag(r.uvarint()));
+                topo->threads_per_core = static_cast<int>(unzigzag(r.uvarint()));
+                topo->caches.resize(r.count());
+                for (CpuCache &c : topo->caches)
+                {
+                    std::uint32_t id;
+                    c.level = static_cast<int>(unzigzag(r.uvarint()));
+                    if (!get_string(r, id))
+                        return fail("bad string reference");
+                    c.type = state_.strings[id];
+                    c.size_kb = static_cast<long>(unzigzag(r.uvarint()));
+                }
+                state_.topology = std::move(topo);
+            }
+        }
+        out.topology = state_.topology;
+
+        for (std::size_t i = 0; i < MEMINFO_FIELD_COUNT; ++i)
+            out.memory.*MEMINFO_FIELDS[i].member = static_cast<long>(get_int(r, state_.meminfo[i]));
+
+        // decoding into the previous scan's rows keeps their string buffers; only
+        // possible when out was the last sample holding it
+        out.process_scan.reset();
+        if (!scan_ || scan_.use_count() > 1)
+            scan_ = std::make_shared<ProcessScan>();
+        if (!get_processes(r, scan_->processes))
+            return fail("bad process rows");
+        scan_->table.assign(scan_->processes);
+        out.process_scan = scan_;
+
+        out.disks.resize(r.count());
+        state_.disks.resize(out.disks.size());
+        for (std::size_t i = 0; i < out.disks.size(); ++i)
+        {
+            DiskStats &d = out.disks[i];
+            State::Device &dev = state_.disks[i];
+            if (!get_field(r, dev.name))
+                return fail("bad string reference");
+            d.device = state_.strings[dev.name];
+            d.reads_completed = static_cast<long>(get_int(r, dev.counters[0]));
+            d.writes_completed = static_cast<long>(get_int(r, dev.counters[1]));
+            d.sectors_read = static_cast<long>(get_int(r, dev.counters[2]));
+            d.sectors_written = static_cast<long>(get_int(r, dev.counters[3]));
+            d.read_time_ms = get_double(r, dev.values[0]);
+            d.write_time_ms = get_double(r, dev.values[1]);
+            d.read_rate = get_double(r, dev.values[2]);
+            d.write_rate = get_double(r, dev.values[3]);
+        }
+
+        out.network.resize(r.count());
+        state_.interfaces.resize(out.network.size());
+        for (std::size_t i = 0; i < out.network.size(); ++i)
+        {
+            State::Device &dev = state_.interfaces[i];
+            if (!get_field(r, dev.name))
+                return fail("bad string reference");
+            out.network[i].interface = state_.strings[dev.name];
+            out.network[i].upload_rate = get_double(r, dev.values[0]);
+            out.network[i].download_rate = get_double(r, dev.values[1]);
+        }
+
+        if (r.bad())
+            return fail("truncated frame");
+        state_.primed = true;
+        return true;
+    }
+}
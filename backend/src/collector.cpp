@@ -0,0 +1,355 @@
+#include "collector.hpp"
+
+#include <sampler.hpp>
+#include <snapshot.hpp>
+
+const char *collector_cost_name(CollectorCost cost)
+{
+    switch (cost)
+    {
+    case CollectorCost::Cheap:
+        return "cheap";
+    case CollectorCost::Moderate:
+        return "moderate";
+    case CollectorCost::Expensive:
+        return "expensive";
+    }
+    return "?";
+}
+
+bool parse_collectors(std::string_view spec, CollectorConfig &config, std::string *err)
+{
+    auto fail = [&](const std::string &why)
+    {
+        if (err)
+            *err = why;
+        return false;
+    };
+
+    CollectorConfig out = config;
+    while (!spec.empty())
+    {
+        size_t comma = spec.find(',');
+        std::string_view item = spec.substr(0, comma);
+        spec = (comma == std::string_view::npos) ? std::string_view() : spec.substr(comma + 1);
+
+        size_t eq = item.find('=');
+        if (eq == std::string_view::npos)
+            return fail("expected <collector>=<interval|off|on>, got '" + std::string(item) + "'");
+        std::string_view name = item.substr(0, eq);
+        std::string_view value = item.substr(eq + 1);
+
+        bool known = false;
+        for (const auto &c : BUILTIN_COLLECTORS)
+            known = known || name == c.name;
+        if (!known)
+            return fail("unknown collector '" + std::string(name) + "'");
+
+        CollectorSetting &setting = out[std::string(name)];
+        if (value == "off" || value == "on")
+        {
+            setting.enabled = value == "on";
+            continue;
+        }
+
+        long scale = 1;
+        if (value.size() > 2 && value.substr(value.size() - 2) == "ms")
+            value.remove_suffix(2);
+        else if (value.size() > 1 && value.back() == 's')
+        {
+            value.remove_suffix(1);
+            scale = 1000;
+        }
+        long ms = 0;
+        if (!procfs::parse(value, ms) || ms < 0)
+            return fail("bad interval for collector '" + std::string(name) + "'");
+        setting.enabled = true;
+        setting.interval = std::chrono::milliseconds(ms * scale);
+    }
+    config = std::move(out);
+    return true;
+}
+
+unsigned collected_sections(const CollectorConfig &config)
+{
+    unsigned sections = 0;
+    for (const auto &c : BUILTIN_COLLECTORS)
+    {
+        auto it = config.find(c.name);
+        if (it == config.end() || it->second.enabled)
+            sections |= c.sections;
+    }
+    return sections;
+}
+
+void disable_unused_collectors(unsigned sections, CollectorConfig &config)
+{
+    for (const auto &c : BUILTIN_COLLECTORS)
+        if (!(c.sections & sections))
+            config.emplace(c.name, CollectorSetting{false});
+}
+
+// ---- shared inputs ----
+
+enum : unsigned
+{
+    READ_STAT = 1u << 0,
+    READ_CPU = 1u << 1,
+    READ_MEMINFO = 1u << 2,
+    READ_NET_DEV = 1u << 3,
+    READ_DISKSTATS = 1u << 4,
+    READ_TOPOLOGY = 1u << 5,
+};
+
+void TickInputs::begin(std::chrono::steady_clock::time_point now)
+{
+    now_ = now;
+    read_ = 0;
+}
+
+std::string_view TickInputs::stat()
+{
+    if (!(read_ & READ_STAT) && !stat_file_.read(stat_buf_))
+        return {};
+    read_ |= READ_STAT;
+    return stat_buf_.view();
+}
+
+const std::vector<CpuTimes> &TickInputs::cpu_times()
+{
+    if (!(read_ & READ_CPU))
+    {
+        cpu_ = parse_cpu_times(stat());
+        read_ |= READ_CPU;
+    }
+    return cpu_;
+}
+
+long long TickInputs::running_processes()
+{
+    return parse_running_processes(stat());
+}
+
+const MemInfo &TickInputs::memory()
+{
+    if (!(read_ & READ_MEMINFO))
+    {
+        memory_ = meminfo_file_.read(meminfo_buf_) ? parse_meminfo(meminfo_buf_.view()) : MemInfo{};
+        read_ |= READ_MEMINFO;
+    }
+    return memory_;
+}
+
+std::string_view TickInputs::net_dev()
+{
+    if (!(read_ & READ_NET_DEV) && !net_dev_file_.read(net_dev_buf_))
+        return {};
+    read_ |= READ_NET_DEV;
+    return net_dev_buf_.view();
+}
+
+std::string_view TickInputs::diskstats()
+{
+    if (!(read_ & READ_DISKSTATS) && !diskstats_file_.read(diskstats_buf_))
+        return {};
+    read_ |= READ_DISKSTATS;
+    return diskstats_buf_.view();
+}
+
+const std::shared_ptr<const CpuTopology> &TickInputs::topology()
+{
+    if (!(read_ & READ_TOPOLOGY))
+    {
+        topology_ = cpu_topology();
+        read_ |= READ_TOPOLOGY;
+    }
+    return topology_;
+}
+
+// ---- built-in collectors ----
+
+namespace
+{
+    // seconds since the collector's previous run, 0 on its first
+    class Window
+    {
+    public:
+        double advance(std::chrono::steady_clock::time_point now)
+        {
+            double seconds = primed_ ? std::chrono::duration<double>(now - prev_).count() : 0.0;
+            prev_ = now;
+            primed_ = true;
+            return seconds;
+        }
+        bool primed() const { return primed_; }
+
+    private:
+        std::chrono::steady_clock::time_point prev_;
+        bool primed_ = false;
+    };
+
+    class CpuCollector : public Collector
+    {
+    public:
+        void collect(TickInputs &in, SystemSample &s) override
+        {
+            // first entry is the aggregate line, the rest are cores
+            const auto &cpu = in.cpu_times();
+            s.cpu_usage = 0.0;
+            s.per_core_usage.assign(cpu.empty() ? 0 : cpu.size() - 1, 0.0);
+            if (!prev_.empty() && prev_.size() == cpu.size())
+            {
+                s.cpu_usage = cpu_usage_between(prev_[0], cpu[0]);
+                for (size_t i = 1; i < cpu.size(); ++i)
+                    s.per_core_usage[i - 1] = cpu_usage_between(prev_[i], cpu[i]);
+            }
+            prev_ = cpu;
+
+            s.running_processes = in.running_processes();
+            s.topology = in.topology();
+            s.cpu_name = s.topology->model_name;
+            s.logical_processors = s.topology->logical_cpus;
+        }
+
+        void carry(const SystemSample &prev, SystemSample &s) override
+        {
+            s.cpu_usage = prev.cpu_usage;
+            s.per_core_usage = prev.per_core_usage;
+            s.running_processes = prev.running_processes;
+            s.topology = prev.topology;
+            s.cpu_name = prev.cpu_name;
+            s.logical_processors = prev.logical_processors;
+        }
+
+    private:
+        std::vector<CpuTimes> prev_;
+    };
+
+    class FrequencyCollector : public Collector
+    {
+    public:
+        void collect(TickInputs &, SystemSample &s) override
+        {
+            s.per_core_frequency = get_per_core_frequency();
+            s.cpu_frequency = 0.0;
+            for (double mhz : s.per_core_frequency)
+                s.cpu_frequency += mhz;
+            if (!s.per_core_frequency.empty())
+                s.cpu_frequency /= static_cast<double>(s.per_core_frequency.size());
+        }
+
+        void carry(const SystemSample &prev, SystemSample &s) override
+        {
+            s.per_core_frequency = prev.per_core_frequency;
+            s.cpu_frequency = prev.cpu_frequency;
+        }
+    };
+
+    class MemoryCollector : public Collector
+    {
+    public:
+        void collect(TickInputs &in, SystemSample &s) override
+        {
+            s.memory = in.memory();
+            s.memory_usage = memory_usage_percent(s.memory);
+        }
+
+        void carry(const SystemSample &prev, SystemSample &s) override
+        {
+            s.memory = prev.memory;
+            s.memory_usage = prev.memory_usage;
+        }
+    };
+
+    class DiskCollector : public Collector
+    {
+    public:
+        void collect(TickInputs &in, SystemSample &s) override
+        {
+            auto disks = parse_disk_stats(in.diskstats());
+            double seconds = window_.advance(in.now());
+            if (seconds > 0.0)
+                compute_disk_rates(disks, prev_, seconds);
+            s.disks = disks;
+            prev_ = std::move(disks);
+        }
+
+        void carry(const SystemSample &prev, SystemSample &s) override { s.disks = prev.disks; }
+
+    private:
+        Window window_;
+        std::vector<DiskStats> prev_;
+    };
+
+    class NetworkCollector : public Collector
+    {
+    public:
+        void collect(TickInputs &in, SystemSample &s) override
+        {
+            auto net = parse_raw_net(in.net_dev());
+            bool primed = window_.primed();
+            double seconds = window_.advance(in.now());
+            s.network = network_rates_between(primed ? prev_ : net, net, seconds);
+            prev_ = std::move(net);
+        }
+
+        void carry(const SystemSample &prev, SystemSample &s) override { s.network = prev.network; }
+
+    private:
+        Window window_;
+        std::vector<RawNet> prev_;
+    };
+
+    class BatteryCollector : public Collector
+    {
+    public:
+        void collect(TickInputs &, SystemSample &s) override { s.battery = get_battery_info(); }
+        void carry(const SystemSample &prev, SystemSample &s) override { s.battery = prev.battery; }
+    };
+
+    class ProcessCollector : public Collector
+    {
+    public:
+        explicit ProcessCollector(ProcessTracker &tracker) : tracker_(tracker) {}
+
+        void collect(TickInputs &in, SystemSample &s) override
+        {
+            // CPU% is relative to the tracker's previous refresh, however long ago
+            const auto &cpu = in.cpu_times();
+            s.set_processes(tracker_.refresh(cpu.empty() ? 0 : cpu[0].total, in.memory().mem_total,
+                                             in.topology()->logical_cpus));
+        }
+
+        // the rows are immutable once published: share them, don't copy
+        void carry(const SystemSample &prev, SystemSample &s) override { s.process_scan = prev.process_scan; }
+
+    private:
+        ProcessTracker &tracker_;
+    };
+}
+
+// ---- registry ----
+
+template <class T>
+static std::unique_ptr<Collector> make_collector(ProcessTracker &)
+{
+    return std::make_unique<T>();
+}
+
+static std::unique_ptr<Collector> make_processes(ProcessTracker &processes)
+{
+    return std::make_unique<ProcessCollector>(processes);
+}
+
+constexpr std::chrono::milliseconds EVERY_TICK{0};
+
+const CollectorInfo BUILTIN_COLLECTORS[BUILTIN_COLLECTOR_COUNT] = {
+    {"cpu", CollectorCost::Cheap, EVERY_TICK, snapshot::Cpu | snapshot::Cores | snapshot::Topology, "/proc/stat", make_collector<CpuCollector>},
+    {"frequency", CollectorCost::Moderate, EVERY_TICK, snapshot::Cpu | snapshot::Cores, "cpufreq, one sysfs file per cpu", make_collector<FrequencyCollector>},
+    {"memory", CollectorCost::Cheap, EVERY_TICK, snapshot::Memory, "/proc/meminfo", make_collector<MemoryCollector>},
+    {"disk", CollectorCost::Cheap, EVERY_TICK, snapshot::Disk, "/proc/diskstats", make_collector<DiskCollector>},
+    {"network", CollectorCost::Cheap, EVERY_TICK, snapshot::Network, "/proc/net/dev", make_collector<NetworkCollector>},
+    // charge moves by a percent a minute at most
+    {"battery", CollectorCost::Moderate, std::chrono::milliseconds(5000), snapshot::Battery, "/sys/class/power_supply/BAT*", make_collector<BatteryCollector>},
+    {"processes", CollectorCost::Expensive, EVERY_TICK, snapshot::Processes, "/proc/<pid>/stat, status, ... for every pid", make_processes},
+};
@@ -1,226 +1,336 @@
 #include "cpu.hpp"
+#include "procfs.hpp"
+#include <algorithm>
+#include <charconv>
+#include <mutex>
 #include <vector>
-#include <fstream>
-#include <sstream>
 #include <string>
-#include <thread>
-#include <chrono>
 
 // this is just for displaying CPU stats:
 // 1. usage, 2. frequency (speed), 3. no of processes and threads
 
-double get_cpu_usage();
-std::string get_cpu_name();
-long long get_running_processes();
-double get_cpu_frequency();
-int get_no_logical_processors();
-std::vector<double> get_per_core_usage();
-
-double get_cpu_usage()
+// per-thread read buffers, reused across calls
+static procfs::Buffer &stat_buffer()
 {
-    static long prev_idle = 0, prev_total = 0;
-    static bool initialized = false;
-
-    auto read_totals = []() -> std::pair<long, long>
-    {
-        std::ifstream file("/proc/stat");
-        std::string line;
-        if (!std::getline(file, line))
-            return {0, 0};
-        std::istringstream iss(line);
-        std::string cpu;
-        long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0, guest = 0, guest_nice = 0;
-        iss >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal >> guest >> guest_nice;
-
-        long idle_time = idle + iowait;
-        long non_idle = user + nice + system + irq + softirq + steal;
-        long total = idle_time + non_idle;
-        return {idle_time, total};
-    };
+    thread_local procfs::Buffer buf(16384);
+    return buf;
+}
 
-    auto [idle_time, total_time] = read_totals();
+// small sysfs attribute as an integer; false if missing
+static bool read_sys_long(const std::string &path, long &out, procfs::Buffer &buf)
+{
+    return buf.load(path.c_str()) && procfs::Tokenizer(buf.view()).next(out);
+}
 
-    if (!initialized)
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+static std::vector<int> parse_cpu_list(std::string_view list)
+{
+    std::vector<int> ids;
+    list = procfs::trim(list.substr(0, list.find('\n')));
+    while (!list.empty())
     {
-        prev_idle = idle_time;
-        prev_total = total_time;
-        initialized = true;
+        size_t comma = list.find(',');
+        std::string_view range = list.substr(0, comma);
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(250));
-        std::tie(idle_time, total_time) = read_totals();
+        size_t dash = range.find('-');
+        int lo = 0, hi = 0;
+        if (!procfs::parse(range.substr(0, dash), lo))
+            continue;
+        hi = lo;
+        if (dash != std::string_view::npos && !procfs::parse(range.substr(dash + 1), hi))
+            continue;
+        for (int id = lo; id <= hi; ++id)
+            ids.push_back(id);
     }
-
-    long idle_diff = idle_time - prev_idle;
-    long total_diff = total_time - prev_total;
-
-    double usage = 0.0;
-    if (total_diff > 0)
-        usage = 100.0 * (1.0 - (double)idle_diff / (double)total_diff);
-
-    prev_idle = idle_time;
-    prev_total = total_time;
-
-    return usage < 0.0 ? 0.0 : (usage > 100.0 ? 100.0 : usage);
+    return ids;
 }
 
-std::string get_cpu_name()
+static std::shared_ptr<CpuTopology> build_topology(std::string_view online_list)
 {
-    std::ifstream file("/proc/cpuinfo");
-    std::string key;
+    auto t = std::make_shared<CpuTopology>();
+    procfs::Buffer buf(65536);
+    const std::string sys = "/sys/devices/system/cpu/";
 
-    if (!file.is_open())
+    // identity and fallback frequencies come from one cpuinfo read
+    if (buf.load("/proc/cpuinfo"))
     {
-        return "Error: Could not open /proc/cpuinfo.";
-    }
+        t->model_name = parse_cpu_name(buf.view());
+        t->logical_cpus = parse_logical_processors(buf.view());
 
-    while (std::getline(file, key))
-    {
-        if (key.rfind("model name", 0) == 0)
+        procfs::Tokenizer lines(buf.view());
+        while (!lines.done())
         {
-            size_t colon_pos = key.find(':');
-            if (colon_pos != std::string::npos)
-            {
-                std::string cpu_name = key.substr(colon_pos + 1);
-                size_t first_char_pos = cpu_name.find_first_not_of(" \t");
-                if (first_char_pos != std::string::npos)
-                {
-                    return cpu_name.substr(first_char_pos);
-                }
-                return cpu_name;
-            }
+            std::string_view line = lines.next_line();
+            if (line.substr(0, 7) != "cpu MHz")
+                continue;
+            double mhz = 0.0;
+            procfs::parse(procfs::trim(line.substr(line.find(':') + 1)), mhz);
+            t->base_mhz.push_back(mhz);
         }
     }
-    return "Error: CPU model not found.";
-}
+    else
+    {
+        t->model_name = "Error: Could not open /proc/cpuinfo.";
+    }
 
-long long get_running_processes()
-{
-    std::ifstream file("/proc/stat");
-    std::string line;
-    long long num_processes = 0;
+    t->online = parse_cpu_list(online_list);
+    if (t->online.empty())
+    {
+        // no sysfs: assume cpus 0..n-1 from cpuinfo
+        for (int i = 0; i < t->logical_cpus; ++i)
+            t->online.push_back(i);
+    }
+    t->logical_cpus = static_cast<int>(t->online.size());
 
-    while (std::getline(file, line))
+    // cores and sockets from each online cpu's topology ids
+    std::vector<std::pair<long, long>> cores;
+    std::vector<long> packages;
+    for (int id : t->online)
+    {
+        const std::string dir = sys + "cpu" + std::to_string(id) + "/topology/";
+        long package = 0, core = id;
+        read_sys_long(dir + "physical_package_id", package, buf);
+        read_sys_long(dir + "core_id", core, buf);
+        cores.emplace_back(package, core);
+        packages.push_back(package);
+    }
+    std::sort(cores.begin(), cores.end());
+    cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+    std::sort(packages.begin(), packages.end());
+    packages.erase(std::unique(packages.begin(), packages.end()), packages.end());
+    t->physical_cores = std::max<int>(1, static_cast<int>(cores.size()));
+    t->sockets = std::max<int>(1, static_cast<int>(packages.size()));
+    t->threads_per_core = std::max(1, t->logical_cpus / t->physical_cores);
+
+    t->numa_nodes = buf.load("/sys/devices/system/node/online")
+                        ? static_cast<int>(parse_cpu_list(buf.view()).size())
+                        : 1;
+
+    // caches of the first online cpu: cache/index<N>/{level,type,size}
+    if (!t->online.empty())
     {
-        if (line.rfind("procs_running ", 0) == 0)
+        const std::string dir = sys + "cpu" + std::to_string(t->online.front()) + "/cache/index";
+        for (int i = 0;; ++i)
         {
-            size_t pos = line.find(" ");
-            if (pos != std::string::npos)
-            {
-                num_processes = std::stoll(line.substr(pos + 1));
+            const std::string index = dir + std::to_string(i) + "/";
+            CpuCache c{0, "", 0};
+            long level = 0;
+            if (!read_sys_long(index + "level", level, buf))
                 break;
+            c.level = static_cast<int>(level);
+            if (buf.load((index + "type").c_str()))
+                c.type = std::string(procfs::trim(procfs::Tokenizer(buf.view()).next_line()));
+            if (buf.load((index + "size").c_str()))
+            {
+                // "48K": parse the leading digits and ignore the suffix
+                std::string_view size = buf.view();
+                std::from_chars(size.data(), size.data() + size.size(), c.size_kb);
             }
+            t->caches.push_back(std::move(c));
         }
     }
 
-    file.close();
-    if (num_processes <= 0)
+    return t;
+}
+
+static std::mutex topology_mutex;
+static std::shared_ptr<const CpuTopology> topology;
+static std::string topology_online; // online list the cached topology was built from
+
+std::shared_ptr<const CpuTopology> cpu_topology()
+{
+    // re-reading the tiny online mask is the whole per-call cost
+    static procfs::File online_file("/sys/devices/system/cpu/online");
+    thread_local procfs::Buffer buf(256);
+    std::string_view online = online_file.read(buf) ? buf.view() : std::string_view{};
+
+    std::lock_guard<std::mutex> lock(topology_mutex);
+    if (!topology || online != topology_online)
     {
-        return 0;
+        topology = build_topology(online);
+        topology_online = std::string(online);
     }
-    return num_processes;
+    return topology;
 }
 
-double get_cpu_frequency()
+std::vector<double> get_per_core_frequency()
 {
-    std::ifstream file("/proc/cpuinfo");
-    std::string key;
-    double mhz = 0.0;
+    auto t = cpu_topology();
 
-    while (std::getline(file, key))
+    // keep one cpufreq fd per cpu, reopened whenever the topology changes
+    thread_local std::shared_ptr<const CpuTopology> files_for;
+    thread_local std::vector<std::unique_ptr<procfs::File>> files;
+    thread_local procfs::Buffer buf(64);
+    if (files_for != t)
     {
-        if (key.find("cpu MHz") == 0)
+        files.clear();
+        for (int id : t->online)
         {
-            std::stringstream ss(key.substr(key.find(":") + 1));
-            ss >> mhz;
-            break;
+            const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/cpufreq/scaling_cur_freq";
+            files.push_back(std::make_unique<procfs::File>(path.c_str()));
         }
+        files_for = t;
+    }
+
+    std::vector<double> mhz(t->online.size(), 0.0);
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        long khz = 0;
+        if (files[i]->read(buf) && procfs::Tokenizer(buf.view()).next(khz))
+            mhz[i] = static_cast<double>(khz) / 1000.0;
+        else if (i < t->base_mhz.size())
+            mhz[i] = t->base_mhz[i];
     }
-    return mhz; // NOTE: value is in MHz, can mult by 0.001 for GHz
+    return mhz;
 }
 
-int get_no_logical_processors()
+std::vector<CpuTimes> parse_cpu_times(std::string_view stat)
 {
-    std::ifstream file("/proc/cpuinfo");
-    std::string key;
-    int no_processors = 0;
-
-    while (std::getline(file, key))
+    std::vector<CpuTimes> times;
+    procfs::Tokenizer lines(stat);
+    while (!lines.done())
     {
-        if (key.find("processor") == 0)
-        {
-            no_processors++;
-        }
+        std::string_view line = lines.next_line();
+        if (line.substr(0, 3) != "cpu")
+            break; // cpu lines come first
+
+        procfs::Tokenizer iss(line);
+        long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+        if (!(iss.skip(1) && iss.next(user) && iss.next(nice) && iss.next(system) && iss.next(idle) &&
+              iss.next(iowait) && iss.next(irq) && iss.next(softirq) && iss.next(steal)))
+            continue;
+
+        long idle_time = idle + iowait;
+        long non_idle = user + nice + system + irq + softirq + steal;
+        times.push_back({idle_time, idle_time + non_idle});
     }
+    return times;
+}
 
-    return no_processors;
+std::vector<CpuTimes> read_cpu_times()
+{
+    procfs::Buffer &buf = stat_buffer();
+    if (!buf.load("/proc/stat"))
+        return {};
+    return parse_cpu_times(buf.view());
 }
 
-std::vector<double> get_per_core_usage()
+double cpu_usage_between(const CpuTimes &prev, const CpuTimes &cur)
 {
-    static std::vector<long> prev_idle_times;
-    static std::vector<long> prev_total_times;
-    static bool first_call = true;
+    long idle_diff = cur.idle - prev.idle;
+    long total_diff = cur.total - prev.total;
 
-    std::ifstream file("/proc/stat");
-    std::string line;
-    std::vector<long> idle_times;
-    std::vector<long> total_times;
+    if (total_diff <= 0)
+        return 0.0;
 
-    while (std::getline(file, line))
-    {
-        if (line.rfind("cpu", 0) == 0 && line != "cpu")
-        {
-            std::istringstream iss(line);
-            std::string cpu_label;
-            long user, nice, system, idle, iowait, irq, softirq, steal;
+    double usage = 100.0 * (1.0 - static_cast<double>(idle_diff) / static_cast<double>(total_diff));
+    return usage < 0.0 ? 0.0 : (usage > 100.0 ? 100.0 : usage);
+}
 
-            if (!(iss >> cpu_label >> user >> nice >> system >> idle >>
-                  iowait >> irq >> softirq >> steal))
-                continue;
+double get_cpu_usage()
+{
+    static CpuTimes prev{0, 0};
+    static bool initialized = false;
 
-            if (cpu_label == "cpu")
-                continue;
+    auto times = read_cpu_times();
+    if (times.empty())
+        return 0.0;
 
-            long total_idle = idle + iowait;
+    double usage = initialized ? cpu_usage_between(prev, times[0]) : 0.0;
+    prev = times[0];
+    initialized = true;
+    return usage;
+}
 
-            long total_non_idle = user + nice + system + irq + softirq + steal;
+std::string parse_cpu_name(std::string_view cpuinfo)
+{
+    std::string_view name = procfs::find_key(cpuinfo, "model name");
+    if (name.empty())
+        return "Error: CPU model not found.";
+    return std::string(name);
+}
 
-            long total = total_idle + total_non_idle;
+std::string get_cpu_name()
+{
+    return cpu_topology()->model_name;
+}
 
-            idle_times.push_back(total_idle);
-            total_times.push_back(total);
-        }
+long long parse_running_processes(std::string_view stat)
+{
+    long long num_processes = 0;
+
+    size_t pos = stat.find("\nprocs_running ");
+    if (pos != std::string_view::npos)
+    {
+        procfs::Tokenizer iss(stat.substr(pos + 1));
+        iss.skip(1);
+        iss.next(num_processes);
     }
 
-    if (first_call || prev_idle_times.size() != idle_times.size())
+    if (num_processes <= 0)
     {
-        prev_idle_times = idle_times;
-        prev_total_times = total_times;
-        first_call = false;
+        return 0;
+    }
+    return num_processes;
+}
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+long long get_running_processes()
+{
+    procfs::Buffer &buf = stat_buffer();
+    if (!buf.load("/proc/stat"))
+        return 0;
+    return parse_running_processes(buf.view());
+}
 
-        return get_per_core_usage();
-    }
+double get_cpu_frequency()
+{
+    auto mhz = get_per_core_frequency();
+    if (mhz.empty())
+        return 0.0;
+    double sum = 0.0;
+    for (double f : mhz)
+        sum += f;
+    return sum / static_cast<double>(mhz.size()); // NOTE: value is in MHz, can mult by 0.001 for GHz
+}
 
-    std::vector<double> usages(idle_times.size(), 0.0);
-    for (size_t i = 0; i < idle_times.size() && i < prev_idle_times.size(); ++i)
-    {
-        long idle_diff = idle_times[i] - prev_idle_times[i];
-        long total_diff = total_times[i] - prev_total_times[i];
+int parse_logical_processors(std::string_view cpuinfo)
+{
+    int no_processors = 0;
 
-        if (total_diff <= 0)
+    procfs::Tokenizer lines(cpuinfo);
+    while (!lines.done())
+    {
+        if (lines.next_line().substr(0, 9) == "processor")
         {
-            usages[i] = 0.0;
-            continue;
+            no_processors++;
         }
-
-        double usage = 100.0 * (1.0 - (double)idle_diff / (double)total_diff);
-        usages[i] = (usage < 0.0) ? 0.0 : (usage > 100.0 ? 100.0 : usage);
     }
 
-    prev_idle_times = idle_times;
-    prev_total_times = total_times;
+    return no_processors;
+}
+
+int get_no_logical_processors()
+{
+    return cpu_topology()->logical_cpus;
+}
+
+std::vector<double> get_per_core_usage()
+{
+    static std::vector<CpuTimes> prev;
 
+    auto times = read_cpu_times();
+    if (times.empty())
+        return {};
+    times.erase(times.begin()); // drop the aggregate line
+
+    std::vector<double> usages(times.size(), 0.0);
+    if (prev.size() == times.size())
+    {
+        for (size_t i = 0; i < times.size(); ++i)
+            usages[i] = cpu_usage_between(prev[i], times[i]);
+    }
+
+    prev = std::move(times);
     return usages;
-}
\ No newline at end of file
+}
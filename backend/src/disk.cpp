@@ -1,33 +1,41 @@
 #include "disk.hpp"
-#include <fstream>
-#include <sstream>
+#include "procfs.hpp"
+#include <unordered_map>
 #include <vector>
 
 using json = nlohmann::json;
 
 std::vector<DiskStats> get_disk_stats()
 {
-    std::vector<DiskStats> disks;
-    std::ifstream file("/proc/diskstats");
-    std::string line;
+    thread_local procfs::Buffer buf(8192);
+    if (!buf.load("/proc/diskstats"))
+        return {};
+    return parse_disk_stats(buf.view());
+}
 
-    while (std::getline(file, line))
+std::vector<DiskStats> parse_disk_stats(std::string_view diskstats)
+{
+    std::vector<DiskStats> disks;
+    procfs::Tokenizer lines(diskstats);
+    while (!lines.done())
     {
-        std::istringstream iss(line);
+        procfs::Tokenizer iss(lines.next_line());
         int major = 0, minor = 0;
-        std::string dev;
-        if (!(iss >> major >> minor >> dev))
+        if (!(iss.next(major) && iss.next(minor)))
             continue;
+        std::string_view dev = iss.next();
 
         // skip loopback & RAM disks
-        if (dev.find("loop") != std::string::npos || dev.find("ram") != std::string::npos)
+        if (dev.find("loop") != std::string_view::npos || dev.find("ram") != std::string_view::npos)
             continue;
 
         unsigned long long rd_ios = 0, rd_merged = 0, rd_sectors = 0, rd_time = 0;
         unsigned long long wr_ios = 0, wr_merged = 0, wr_sectors = 0, wr_time = 0;
         unsigned long long ios_in_prog = 0, io_time = 0, weighted_io_time = 0;
 
-        if (!(iss >> rd_ios >> rd_merged >> rd_sectors >> rd_time >> wr_ios >> wr_merged >> wr_sectors >> wr_time >> ios_in_prog >> io_time >> weighted_io_time))
+        if (!(iss.next(rd_ios) && iss.next(rd_merged) && iss.next(rd_sectors) && iss.next(rd_time) &&
+              iss.next(wr_ios) && iss.next(wr_merged) && iss.next(wr_sectors) && iss.next(wr_time) &&
+              iss.next(ios_in_prog) && iss.next(io_time) && iss.next(weighted_io_time)))
             continue;
 
         DiskStats d;
@@ -38,6 +46,8 @@ std::vector<DiskStats> get_disk_stats()
         d.sectors_written = static_cast<long>(wr_sectors);
         d.read_time_ms = static_cast<double>(rd_time);
         d.write_time_ms = static_cast<double>(wr_time);
+        d.read_rate = 0.0;
+        d.write_rate = 0.0;
 
         disks.push_back(d);
     }
@@ -45,6 +55,31 @@ std::vector<DiskStats> get_disk_stats()
     return disks;
 };
 
+void compute_disk_rates(std::vector<DiskStats> &cur, const std::vector<DiskStats> &prev, double seconds)
+{
+    if (seconds <= 0.0)
+        return;
+
+    std::unordered_map<std::string, const DiskStats *> byName;
+    byName.reserve(prev.size());
+    for (const auto &d : prev)
+        byName[d.device] = &d;
+
+    // /proc/diskstats always counts 512-byte sectors regardless of the device's block size
+    const double sector_bytes = 512.0;
+    for (auto &d : cur)
+    {
+        auto it = byName.find(d.device);
+        if (it == byName.end())
+            continue;
+
+        long drd = d.sectors_read - it->second->sectors_read;
+        long dwr = d.sectors_written - it->second->sectors_written;
+        d.read_rate = drd > 0 ? sector_bytes * static_cast<double>(drd) / seconds : 0.0;
+        d.write_rate = dwr > 0 ? sector_bytes * static_cast<double>(dwr) / seconds : 0.0;
+    }
+}
+
 json disk_to_json(const DiskStats &d)
 {
     return {
@@ -54,5 +89,22 @@ json disk_to_json(const DiskStats &d)
         {"sectors_read", d.sectors_read},
         {"sectors_written", d.sectors_written},
         {"read_time_ms", d.read_time_ms},
-        {"write_time_ms", d.write_time_ms}};
-};
\ No newline at end of file
+        {"write_time_ms", d.write_time_ms},
+        {"read_rate_bytes_per_sec", d.read_rate},
+        {"write_rate_bytes_per_sec", d.write_rate}};
+};
+
+DiskStats disk_from_json(const json &j)
+{
+    DiskStats d;
+    d.device = j.value("device", std::string());
+    d.reads_completed = j.value("reads_completed", 0L);
+    d.writes_completed = j.value("writes_completed", 0L);
+    d.sectors_read = j.value("sectors_read", 0L);
+    d.sectors_written = j.value("sectors_written", 0L);
+    d.read_time_ms = j.value("read_time_ms", 0.0);
+    d.write_time_ms = j.value("write_time_ms", 0.0);
+    d.read_rate = j.value("read_rate_bytes_per_sec", 0.0);
+    d.write_rate = j.value("write_rate_bytes_per_sec", 0.0);
+    return d;
+}
\ No newline at end of file
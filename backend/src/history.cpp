@@ -0,0 +1,378 @@
+#include "history.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <sampler_thread.hpp>
+
+namespace history
+{
+    static_assert(sizeof(RingHeader) <= HEADER_BYTES && sizeof(RecordHeader) == 32, "ring layout");
+
+    static std::uint64_t align8(std::uint64_t n) { return (n + 7) & ~std::uint64_t(7); }
+
+    // FNV-1a over 8 byte words: a torn-write check, not a cryptographic one
+    static std::uint64_t checksum(const char *p, std::size_t n)
+    {
+        std::uint64_t h = 0xcbf29ce484222325ull;
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            std::uint64_t w;
+            std::memcpy(&w, p + i, 8);
+            h = (h ^ w) * 0x100000001b3ull;
+        }
+        for (; i < n; ++i)
+            h = (h ^ static_cast<unsigned char>(p[i])) * 0x100000001b3ull;
+        return h;
+    }
+
+    // where the record at pos really starts: the front of the ring after a wrap marker
+    // or when too little space is left for a record header
+    static std::uint64_t resolve(const char *data, std::uint64_t capacity, std::uint64_t pos)
+    {
+        if (capacity - pos < sizeof(RecordHeader))
+            return 0;
+        const RecordHeader *rh = reinterpret_cast<const RecordHeader *>(data + pos);
+        return rh->magic == WRAP_MAGIC ? 0 : pos;
+    }
+
+    static bool is_record(std::uint32_t magic)
+    {
+        return magic == RECORD_MAGIC || magic == KEYFRAME_MAGIC || magic == DELTA_MAGIC;
+    }
+
+    std::string ring_path(const std::string &dir)
+    {
+        return dir + "/buzz-history.ring";
+    }
+
+    // ---- writer ----
+
+    HistoryWriter::~HistoryWriter()
+    {
+        if (map_)
+            ::munmap(map_, size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    bool HistoryWriter::open(const std::string &path, std::size_t bytes, std::string *err)
+    {
+        auto fail = [&](const std::string &why)
+        {
+            if (err)
+                *err = path + ": " + why;
+            return false;
+        };
+
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            return fail(std::strerror(errno));
+        if (::flock(fd_, LOCK_EX | LOCK_NB) != 0)
+            return fail("already being recorded to");
+
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0)
+            return fail(std::strerror(errno));
+        bool fresh = st.st_size == 0;
+        if (fresh)
+        {
+            // allocate every block now: a full disk would otherwise surface as
+            // SIGBUS on a store into the mapping, and usage stays bounded from the start
+            long page = ::sysconf(_SC_PAGESIZE);
+            size_ = std::max(bytes, HEADER_BYTES + (1u << 20));
+            size_ = (size_ + page - 1) / page * page;
+            int rc = ::posix_fallocate(fd_, 0, static_cast<off_t>(size_));
+            if (rc == EOPNOTSUPP || rc == EINVAL)
+                rc = ::ftruncate(fd_, static_cast<off_t>(size_)) == 0 ? 0 : errno;
+            if (rc != 0)
+                return fail(std::strerror(rc));
+        }
+        else
+        {
+            size_ = static_cast<std::size_t>(st.st_size);
+        }
+
+        void *map = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED)
+        {
+            map_ = nullptr;
+            return fail(std::string("mmap: ") + std::strerror(errno));
+        }
+        map_ = static_cast<char *>(map);
+        header_ = reinterpret_cast<RingHeader *>(map_);
+
+        if (fresh)
+        {
+            std::memcpy(header_->magic, RING_MAGIC, sizeof(header_->magic));
+            header_->version = RING_VERSION;
+            header_->endian = snapshot::BINARY_ENDIAN;
+            header_->capacity = size_ - HEADER_BYTES;
+            header_->head = header_->tail = 0;
+            header_->first_seq = header_->next_seq = 0;
+            return true;
+        }
+
+        // reopening: append after what is there
+        if (size_ < HEADER_BYTES || std::memcmp(header_->magic, RING_MAGIC, sizeof(header_->magic)) != 0)
+            return fail("not a buzz history ring");
+        if (header_->version != RING_VERSION || header_->endian != snapshot::BINARY_ENDIAN)
+            return fail("unsupported history ring version");
+        if (header_->capacity != size_ - HEADER_BYTES || header_->head >= header_->capacity ||
+            header_->tail >= header_->capacity || header_->first_seq > header_->next_seq)
+            return fail("corrupt history ring header");
+        return true;
+    }
+
+    // drop the oldest records while they start inside [from, to)
+    void HistoryWriter::evict(std::uint64_t from, std::uint64_t to)
+    {
+        RingHeader &h = *header_;
+        while (h.first_seq < h.next_seq && h.tail >= from && h.tail < to)
+        {
+            const RecordHeader *rh = reinterpret_cast<const RecordHeader *>(data() + h.tail);
+            if (!is_record(rh->magic) || rh->size > h.capacity - h.tail - sizeof(RecordHeader))
+            {
+                // unreadable from here on anyway: start over empty
+                h.tail = h.head;
+                h.first_seq = h.next_seq;
+                break;
+            }
+            ++h.first_seq;
+            h.tail = (h.first_seq == h.next_seq) ? h.head
+                                                  : resolve(data(), h.capacity, h.tail + align8(sizeof(RecordHeader) + rh->size));
+        }
+    }
+
+    bool HistoryWriter::append(const SystemSample &s, std::string *err)
+    {
+        RingHeader &h = *header_;
+        bool keyframe = since_key_ + 1 >= KEYFRAME_INTERVAL;
+        frame_.clear();
+        encoder_.encode(s, keyframe, frame_);
+        since_key_ = keyframe ? 0 : since_key_ + 1;
+        std::uint64_t need = align8(sizeof(RecordHeader) + frame_.size());
+        if (need > h.capacity)
+        {
+            if (err)
+                *err = "sample of " + std::to_string(need) + " bytes is larger than the history ring";
+            return false;
+        }
+
+        std::uint64_t pos = h.head;
+        if (h.capacity - pos < need)
+        {
+            evict(pos, h.capacity);
+            if (h.capacity - pos >= sizeof(RecordHeader))
+            {
+                RecordHeader wrap{};
+                wrap.magic = WRAP_MAGIC;
+                std::memcpy(data() + pos, &wrap, sizeof(wrap));
+            }
+            pos = 0;
+        }
+        evict(pos, pos + need);
+        if (h.first_seq == h.next_seq)
+            h.tail = pos; // was empty
+
+        // record first, then publish it
+        char *rec = data() + pos;
+        std::memcpy(rec + sizeof(RecordHeader), frame_.data(), frame_.size());
+        RecordHeader rh{};
+        rh.magic = keyframe ? KEYFRAME_MAGIC : DELTA_MAGIC;
+        rh.size = static_cast<std::uint32_t>(frame_.size());
+        rh.seq = h.next_seq;
+        rh.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(s.timestamp.time_since_epoch()).count();
+        rh.checksum = checksum(rec + sizeof(RecordHeader), frame_.size());
+        std::memcpy(rec, &rh, sizeof(rh));
+
+        std::atomic_thread_fence(std::memory_order_release);
+        std::uint64_t head = pos + need;
+        h.head = (h.capacity - head < sizeof(RecordHeader)) ? 0 : head;
+        ++h.next_seq;
+        return true;
+    }
+
+    // ---- reader ----
+
+    HistoryReader::~HistoryReader()
+    {
+        if (map_)
+            ::munmap(const_cast<char *>(map_), size_);
+    }
+
+    bool HistoryReader::open(const std::string &path, std::string *err)
+    {
+        auto fail = [&](const std::string &why)
+        {
+            if (err)
+                *err = path + ": " + why;
+            return false;
+        };
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return fail(std::strerror(errno));
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < HEADER_BYTES)
+        {
+            ::close(fd);
+            return fail("not a buzz history ring");
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        void *map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return fail(std::string("mmap: ") + std::strerror(errno));
+        map_ = static_cast<const char *>(map);
+
+        // a recorder may still be appending: work from one copy of the header
+        RingHeader h;
+        std::memcpy(&h, map_, sizeof(h));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (std::memcmp(h.magic, RING_MAGIC, sizeof(h.magic)) != 0)
+            return fail("not a buzz history ring");
+        if (h.version != RING_VERSION || h.endian != snapshot::BINARY_ENDIAN)
+            return fail("unsupported history ring version");
+        if (h.capacity != size_ - HEADER_BYTES || h.tail >= h.capacity || h.first_seq > h.next_seq)
+            return fail("corrupt history ring header");
+
+        // walk tail -> head through the record headers only; stop at the first record
+        // that is missing or out of sequence
+        const char *data = map_ + HEADER_BYTES;
+        entries_.clear();
+        decoded_ = SIZE_MAX;
+        std::size_t key = SIZE_MAX;
+        entries_.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(h.next_seq - h.first_seq, h.capacity / 64)));
+        std::uint64_t pos = resolve(data, h.capacity, h.tail);
+        for (std::uint64_t seq = h.first_seq; seq < h.next_seq; ++seq)
+        {
+            const RecordHeader *rh = reinterpret_cast<const RecordHeader *>(data + pos);
+            if (!is_record(rh->magic) || rh->seq != seq || rh->size > h.capacity - pos - sizeof(RecordHeader))
+                break;
+            if (rh->magic != DELTA_MAGIC)
+                key = entries_.size();
+            if (key != SIZE_MAX) // else a delta whose keyframe was overwritten
+                entries_.push_back({rh->timestamp_ns, rh->seq, pos, rh->size, rh->magic, key});
+            pos = resolve(data, h.capacity, pos + align8(sizeof(RecordHeader) + rh->size));
+        }
+        return true;
+    }
+
+    const char *HistoryReader::payload(std::size_t i, std::string *err) const
+    {
+        const Entry &e = entries_[i];
+        const char *rec = map_ + HEADER_BYTES + e.offset;
+        RecordHeader rh;
+        std::memcpy(&rh, rec, sizeof(rh));
+        if (rh.magic != e.magic || rh.seq != e.seq || rh.size != e.size)
+        {
+            if (err)
+                *err = "record " + std::to_string(e.seq) + " was overwritten";
+            return nullptr;
+        }
+        if (rh.checksum != checksum(rec + sizeof(RecordHeader), rh.size))
+        {
+            if (err)
+                *err = "record " + std::to_string(e.seq) + " is damaged";
+            return nullptr;
+        }
+        return rec + sizeof(RecordHeader);
+    }
+
+    bool HistoryReader::record(std::size_t i, snapshot::BinarySnapshot &out, std::string *err) const
+    {
+        if (entries_[i].magic != RECORD_MAGIC)
+        {
+            if (err)
+                *err = "record " + std::to_string(entries_[i].seq) + " is a compressed frame";
+            return false;
+        }
+        const char *p = payload(i, err);
+        return p && out.attach(p, entries_[i].size, err);
+    }
+
+    bool HistoryReader::sample(std::size_t i, SystemSample &out, std::string *err)
+    {
+        const Entry &e = entries_[i];
+        if (e.magic == RECORD_MAGIC)
+        {
+            snapshot::BinarySnapshot b;
+            return record(i, b, err) && snapshot::to_sample(b, out, err);
+        }
+
+        std::size_t from = (decoded_ != SIZE_MAX && decoded_ >= e.key && decoded_ < i) ? decoded_ + 1 : e.key;
+        for (std::size_t k = from; k <= i; ++k)
+        {
+            const char *p = payload(k, err);
+            // the index trusted the header's magic; decoding from a delta would start
+            // from whatever state the decoder was left in
+            if (p && k == e.key && !codec::is_keyframe(p, entries_[k].size))
+            {
+                if (err)
+                    *err = "record " + std::to_string(entries_[k].seq) + " is not the keyframe its header says";
+                p = nullptr;
+            }
+            if (!p || !decoder_.decode(p, entries_[k].size, k == i ? out : skipped_, err))
+            {
+                decoded_ = SIZE_MAX;
+                return false;
+            }
+            decoded_ = k;
+        }
+        return true;
+    }
+
+    // ---- --record ----
+
+    int record(const std::string &dir, std::size_t bytes, int collector_threads, ProcessBackend backend,
+               std::chrono::milliseconds interval, const CollectorConfig &collectors)
+    {
+        if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            std::cerr << "buzz: " << dir << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+
+        HistoryWriter writer;
+        std::string err;
+        std::string path = ring_path(dir);
+        if (!writer.open(path, bytes, &err))
+        {
+            std::cerr << "buzz: " << err << "\n";
+            return 1;
+        }
+        CollectorConfig config = collectors;
+        if (config.find("processes") == config.end())
+            config["processes"].interval = RECORD_PROCESS_INTERVAL;
+        const CollectorSetting &scan = config["processes"];
+        std::cerr << "buzz: recording to " << path << " (" << writer.records() << " records kept so far; processes "
+                  << (!scan.enabled ? std::string("off")
+                                    : "every " + std::to_string(std::max(scan.interval, interval).count()) + " ms")
+                  << ")\n";
+
+        bool ok = true;
+        auto append = [&](const SystemSample &s)
+        {
+            ok = writer.append(s, &err);
+            return ok;
+        };
+        if (!run_until_signal(collector_threads, backend, interval, config, append, &err))
+            ok = false;
+        if (!ok)
+        {
+            std::cerr << "buzz: " << err << "\n";
+            return 1;
+        }
+        return 0;
+    }
+}
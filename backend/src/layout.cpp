@@ -0,0 +1,125 @@
+#include "layout.hpp"
+
+#include <algorithm>
+#include <sys/ioctl.h>
+
+// a table is its title, header, rule and rows, then a closing rule; "(no data)" replaces
+// header, rule and rows when empty
+static constexpr long TABLE_OVERHEAD = 4;
+static constexpr long EMPTY_TABLE = 3;
+
+bool Layout::update(int fd)
+{
+    winsize ws{};
+    int rows = 50, cols = 120; // not a tty
+    if (ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0)
+    {
+        rows = ws.ws_row;
+        cols = ws.ws_col;
+    }
+    if (rows == rows_ && cols == cols_ && plan_valid_)
+        return false;
+
+    rows_ = rows;
+    cols_ = cols;
+    widths_.clear();
+    plan_valid_ = false;
+    return true;
+}
+
+const std::vector<size_t> &Layout::widths(const std::vector<render::Column> &columns)
+{
+    auto it = widths_.find(&columns);
+    if (it != widths_.end())
+        return it->second;
+
+    const size_t padding = 2;         // left margin spaces before the table
+    const size_t inter_col_space = 2; // spaces between columns
+    const size_t budget = static_cast<size_t>(std::max(40, cols_ - 2));
+
+    // start from every column at its base width
+    std::vector<size_t> w(columns.size());
+    size_t used = padding;
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        w[i] = std::max(columns[i].title.size(), columns[i].width);
+        used += (i ? inter_col_space : 0) + w[i];
+    }
+
+    // hide columns by drop rank (rightmost first among equals) until the rest fit
+    while (used > budget)
+    {
+        size_t victim = columns.size();
+        for (size_t i = columns.size(); i-- > 0;)
+            if (w[i] && columns[i].drop && (victim == columns.size() || columns[i].drop > columns[victim].drop))
+                victim = i;
+        if (victim == columns.size())
+        {
+            // only essential columns left: cut from the right
+            for (size_t i = columns.size(); i-- > 1;)
+                if (w[i])
+                {
+                    victim = i;
+                    break;
+                }
+            if (victim == columns.size())
+                break;
+        }
+        used -= w[victim] + inter_col_space;
+        w[victim] = 0;
+    }
+
+    // then hand the rest to flexible columns, left to right
+    size_t extra = used < budget ? budget - used : 0;
+    for (size_t i = 0; i < w.size() && extra > 0; ++i)
+    {
+        if (!w[i] || columns[i].max_width <= w[i])
+            continue;
+        size_t add = std::min(extra, columns[i].max_width - w[i]);
+        w[i] += add;
+        extra -= add;
+    }
+
+    return widths_.emplace(&columns, std::move(w)).first->second;
+}
+
+const PanelPlan &Layout::plan(size_t summary_rows, size_t max_process_rows, size_t cores, size_t interfaces, size_t disks)
+{
+    size_t key[5] = {summary_rows, max_process_rows, cores, interfaces, disks};
+    if (plan_valid_ && std::equal(key, key + 5, plan_key_))
+        return plan_;
+    std::copy(key, key + 5, plan_key_);
+    plan_valid_ = true;
+    plan_ = PanelPlan{};
+
+    // title + rule, summary + rule, and the status and prompt rows at the bottom
+    long avail = rows_ - 2 - (static_cast<long>(summary_rows) + 1) - 2;
+
+    long proc_min = std::min<long>(static_cast<long>(max_process_rows), 5);
+    avail -= TABLE_OVERHEAD + proc_min;
+
+    auto fit = [&](size_t count, bool &show, size_t &rows)
+    {
+        long n = static_cast<long>(count);
+        long height = n ? TABLE_OVERHEAD + n : EMPTY_TABLE;
+        if (height <= avail)
+        {
+            show = true;
+            rows = count;
+            avail -= height;
+        }
+        else if (n > 0 && avail > TABLE_OVERHEAD)
+        {
+            show = true;
+            rows = static_cast<size_t>(avail - TABLE_OVERHEAD);
+            avail = 0;
+        }
+    };
+    fit(cores, plan_.show_cores, plan_.core_rows);
+    fit(interfaces, plan_.show_network, plan_.network_rows);
+    fit(disks, plan_.show_disks, plan_.disk_rows);
+
+    long grow = std::min<long>(avail, static_cast<long>(max_process_rows) - proc_min);
+    plan_.process_rows = static_cast<size_t>(std::max<long>(1, proc_min + grow));
+    return plan_;
+}
@@ -1,47 +1,197 @@
 #include <memory.hpp>
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include <procfs.hpp>
 
-double get_memory_usage();
-long get_mem_value(std::string mem_value);
+using json = nlohmann::json;
 
-double get_memory_usage()
+static procfs::Buffer &meminfo_buffer()
 {
-    std::ifstream file("/proc/meminfo"); // enter memory stream
-    std::string key, unit;
-    long value = 0;
-    double mem_total = 0, mem_available = 0; // link to resource: https://www.kernel.org/doc/html/v5.9/filesystems/proc.html
+    thread_local procfs::Buffer buf(8192);
+    return buf;
+}
 
-    while (file >> key >> value >> unit)
+// MemInfo member for a /proc/meminfo key, or nullptr for keys we don't keep
+// switching on length first means at most a couple of string compares per line
+static long *meminfo_field(MemInfo &m, std::string_view key)
+{
+    switch (key.size())
     {
-        if (key == "MemTotal:")
-            mem_total = value;
-        if (key == "MemAvailable:")
-            mem_available = value;
+    case 5:
+        if (key == "Dirty")
+            return &m.dirty;
+        if (key == "Shmem")
+            return &m.shmem;
+        break;
+    case 4:
+        if (key == "Slab")
+            return &m.slab;
+        break;
+    case 6:
+        if (key == "Cached")
+            return &m.cached;
+        if (key == "Active")
+            return &m.active;
+        if (key == "Mapped")
+            return &m.mapped;
+        break;
+    case 7:
+        if (key == "MemFree")
+            return &m.mem_free;
+        if (key == "Buffers")
+            return &m.buffers;
+        break;
+    case 8:
+        if (key == "MemTotal")
+            return &m.mem_total;
+        if (key == "Inactive")
+            return &m.inactive;
+        if (key == "SwapFree")
+            return &m.swap_free;
+        break;
+    case 9:
+        if (key == "SwapTotal")
+            return &m.swap_total;
+        if (key == "Writeback")
+            return &m.writeback;
+        if (key == "AnonPages")
+            return &m.anon_pages;
+        break;
+    case 10:
+        if (key == "SUnreclaim")
+            return &m.s_unreclaim;
+        if (key == "PageTables")
+            return &m.page_tables;
+        break;
+    case 11:
+        if (key == "SwapCached")
+            return &m.swap_cached;
+        if (key == "KernelStack")
+            return &m.kernel_stack;
+        if (key == "CommitLimit")
+            return &m.commit_limit;
+        break;
+    case 12:
+        if (key == "MemAvailable")
+            return &m.mem_available;
+        if (key == "SReclaimable")
+            return &m.s_reclaimable;
+        if (key == "Committed_AS")
+            return &m.committed_as;
+        if (key == "Hugepagesize")
+            return &m.hugepagesize;
+        break;
+    case 14:
+        if (key == "HugePages_Free")
+            return &m.huge_pages_free;
+        if (key == "HugePages_Rsvd")
+            return &m.huge_pages_rsvd;
+        if (key == "HugePages_Surp")
+            return &m.huge_pages_surp;
+        break;
+    case 15:
+        if (key == "HugePages_Total")
+            return &m.huge_pages_total;
+        break;
     }
+    return nullptr;
+}
+
+MemInfo parse_meminfo(std::string_view meminfo)
+{
+    // link to resource: https://www.kernel.org/doc/html/v5.9/filesystems/proc.html
+    MemInfo m;
+    procfs::Tokenizer lines(meminfo);
+    while (!lines.done())
+    {
+        std::string_view line = lines.next_line();
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+            continue;
 
-    if (mem_total <= 0.0)
+        long *field = meminfo_field(m, line.substr(0, colon));
+        if (field)
+            procfs::Tokenizer(line.substr(colon + 1)).next(*field);
+    }
+    return m;
+}
+
+MemInfo read_meminfo()
+{
+    procfs::Buffer &buf = meminfo_buffer();
+    if (!buf.load("/proc/meminfo"))
+        return {};
+    return parse_meminfo(buf.view());
+}
+
+double memory_usage_percent(const MemInfo &m)
+{
+    if (m.mem_total <= 0)
         return 0.0; // avoid division by zero
 
-    double usage = 100.0 * (1.0 - (mem_available / mem_total));
-    return usage;
+    return 100.0 * (1.0 - (static_cast<double>(m.mem_available) / static_cast<double>(m.mem_total)));
+}
+
+const MemInfoField MEMINFO_FIELDS[MEMINFO_FIELD_COUNT] = {
+    {"mem_total_kb", &MemInfo::mem_total},
+    {"mem_free_kb", &MemInfo::mem_free},
+    {"mem_available_kb", &MemInfo::mem_available},
+    {"buffers_kb", &MemInfo::buffers},
+    {"cached_kb", &MemInfo::cached},
+    {"swap_cached_kb", &MemInfo::swap_cached},
+    {"active_kb", &MemInfo::active},
+    {"inactive_kb", &MemInfo::inactive},
+    {"swap_total_kb", &MemInfo::swap_total},
+    {"swap_free_kb", &MemInfo::swap_free},
+    {"dirty_kb", &MemInfo::dirty},
+    {"writeback_kb", &MemInfo::writeback},
+    {"anon_pages_kb", &MemInfo::anon_pages},
+    {"mapped_kb", &MemInfo::mapped},
+    {"shmem_kb", &MemInfo::shmem},
+    {"slab_kb", &MemInfo::slab},
+    {"s_reclaimable_kb", &MemInfo::s_reclaimable},
+    {"s_unreclaim_kb", &MemInfo::s_unreclaim},
+    {"kernel_stack_kb", &MemInfo::kernel_stack},
+    {"page_tables_kb", &MemInfo::page_tables},
+    {"commit_limit_kb", &MemInfo::commit_limit},
+    {"committed_as_kb", &MemInfo::committed_as},
+    {"huge_pages_total", &MemInfo::huge_pages_total},
+    {"huge_pages_free", &MemInfo::huge_pages_free},
+    {"huge_pages_rsvd", &MemInfo::huge_pages_rsvd},
+    {"huge_pages_surp", &MemInfo::huge_pages_surp},
+    {"hugepagesize_kb", &MemInfo::hugepagesize},
+};
+
+json meminfo_to_json(const MemInfo &m)
+{
+    json j = json::object();
+    for (const auto &f : MEMINFO_FIELDS)
+        j[f.key] = m.*f.member;
+    return j;
+}
+
+MemInfo meminfo_from_json(const json &j)
+{
+    MemInfo m;
+    for (const auto &f : MEMINFO_FIELDS)
+        m.*f.member = j.value(f.key, 0L);
+    return m;
+}
+
+double get_memory_usage()
+{
+    return memory_usage_percent(read_meminfo());
 }
 
 long get_mem_value(std::string mem_value)
 {
-    std::ifstream file("/proc/meminfo");
-    std::string key, unit;
+    procfs::Buffer &buf = meminfo_buffer();
     long value = 0;
-    long desired_value = 0;
+    if (!buf.load("/proc/meminfo"))
+        return value;
 
-    while (file >> key >> value >> unit)
-    {
-        if (key == mem_value)
-        {
-            desired_value = value;
-            break;
-        }
-    }
-    return desired_value; // NOTE: this is in kb
-}
\ No newline at end of file
+    // callers pass the key with its trailing colon, eg "Cached:"
+    std::string_view key = mem_value;
+    if (!key.empty() && key.back() == ':')
+        key.remove_suffix(1);
+    procfs::Tokenizer(procfs::find_key(buf.view(), key)).next(value);
+    return value; // NOTE: this is in kb
+}
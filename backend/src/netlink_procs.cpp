@@ -0,0 +1,347 @@
+#include "netlink_procs.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+
+// the NLMSG_*/NLA_* macros use C-style casts, so walk messages with these instead
+namespace
+{
+    constexpr size_t align4(size_t len) { return (len + 3) & ~size_t{3}; }
+    constexpr size_t nlmsg_hdrlen = align4(sizeof(nlmsghdr));
+    constexpr size_t nla_hdrlen = align4(sizeof(nlattr));
+
+    // calls f(type, payload, payload_len) for each attribute in [data, data + len)
+    template <typename F>
+    void for_each_attr(const char *data, size_t len, F f)
+    {
+        while (len >= sizeof(nlattr))
+        {
+            nlattr attr;
+            std::memcpy(&attr, data, sizeof(attr));
+            if (attr.nla_len < sizeof(nlattr) || attr.nla_len > len)
+                return;
+            f(attr.nla_type & NLA_TYPE_MASK, data + nla_hdrlen, attr.nla_len - nla_hdrlen);
+            size_t step = std::min(len, align4(attr.nla_len));
+            data += step;
+            len -= step;
+        }
+    }
+
+    // append one attribute to a request buffer
+    void put_attr(std::vector<char> &msg, unsigned short type, const void *payload, size_t len)
+    {
+        nlattr attr{};
+        attr.nla_type = type;
+        attr.nla_len = static_cast<unsigned short>(nla_hdrlen + len);
+        size_t at = msg.size();
+        msg.resize(at + align4(attr.nla_len), 0);
+        std::memcpy(msg.data() + at, &attr, sizeof(attr));
+        std::memcpy(msg.data() + at + nla_hdrlen, payload, len);
+    }
+
+    // generic netlink request header + genl header, ready for attributes
+    std::vector<char> genl_request(unsigned short family, unsigned char cmd, unsigned char version, unsigned int seq)
+    {
+        std::vector<char> msg(nlmsg_hdrlen + align4(sizeof(genlmsghdr)), 0);
+        nlmsghdr nlh{};
+        nlh.nlmsg_type = family;
+        nlh.nlmsg_flags = NLM_F_REQUEST;
+        nlh.nlmsg_seq = seq;
+        genlmsghdr genl{};
+        genl.cmd = cmd;
+        genl.version = version;
+        std::memcpy(msg.data(), &nlh, sizeof(nlh));
+        std::memcpy(msg.data() + nlmsg_hdrlen, &genl, sizeof(genl));
+        return msg;
+    }
+
+    // send msg (fixing up its length) and receive one reply; returns the genl attributes
+    bool genl_call(int fd, std::vector<char> &msg, std::vector<char> &reply, const char *&attrs, size_t &attrs_len)
+    {
+        nlmsghdr nlh;
+        std::memcpy(&nlh, msg.data(), sizeof(nlh));
+        nlh.nlmsg_len = static_cast<unsigned int>(msg.size());
+        std::memcpy(msg.data(), &nlh, sizeof(nlh));
+
+        if (::send(fd, msg.data(), msg.size(), 0) < 0)
+            return false;
+
+        // skip any late reply to an earlier request that gave up
+        const unsigned int seq = nlh.nlmsg_seq;
+        reply.resize(8192);
+        do
+        {
+            ssize_t n;
+            do
+                n = ::recv(fd, reply.data(), reply.size(), 0);
+            while (n < 0 && errno == EINTR);
+            if (n < static_cast<ssize_t>(nlmsg_hdrlen))
+                return false;
+
+            std::memcpy(&nlh, reply.data(), sizeof(nlh));
+            if (nlh.nlmsg_len > static_cast<size_t>(n))
+                return false;
+        } while (nlh.nlmsg_seq != seq);
+
+        if (nlh.nlmsg_type == NLMSG_ERROR)
+            return false;
+
+        size_t off = nlmsg_hdrlen + align4(sizeof(genlmsghdr));
+        if (nlh.nlmsg_len < off)
+            return false;
+        attrs = reply.data() + off;
+        attrs_len = nlh.nlmsg_len - off;
+        return true;
+    }
+
+    std::vector<int> list_proc_pids()
+    {
+        std::vector<int> pids;
+        DIR *dir = ::opendir("/proc");
+        if (!dir)
+            return pids;
+        while (dirent *e = ::readdir(dir))
+        {
+            const char *name = e->d_name;
+            if (*name < '1' || *name > '9')
+                continue;
+            char *end = nullptr;
+            long pid = std::strtol(name, &end, 10);
+            if (*end == '\0')
+                pids.push_back(static_cast<int>(pid));
+        }
+        ::closedir(dir);
+        return pids;
+    }
+}
+
+NetlinkProcessSource::~NetlinkProcessSource()
+{
+    if (events_fd_ >= 0)
+        ::close(events_fd_);
+    if (taskstats_fd_ >= 0)
+        ::close(taskstats_fd_);
+}
+
+bool NetlinkProcessSource::open(std::string *err)
+{
+    auto fail = [&](const char *what)
+    {
+        if (err)
+            *err = std::string(what) + ": " + std::strerror(errno);
+        if (events_fd_ >= 0)
+            ::close(events_fd_);
+        if (taskstats_fd_ >= 0)
+            ::close(taskstats_fd_);
+        events_fd_ = taskstats_fd_ = -1;
+        return false;
+    };
+
+    // taskstats: resolve the "TASKSTATS" generic netlink family id
+    taskstats_fd_ = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (taskstats_fd_ < 0)
+        return fail("taskstats socket");
+    {
+        auto msg = genl_request(GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 1, ++seq_);
+        put_attr(msg, CTRL_ATTR_FAMILY_NAME, TASKSTATS_GENL_NAME, sizeof(TASKSTATS_GENL_NAME));
+        std::vector<char> reply;
+        const char *attrs = nullptr;
+        size_t len = 0;
+        if (!genl_call(taskstats_fd_, msg, reply, attrs, len))
+            return fail("taskstats family lookup");
+        for_each_attr(attrs, len, [&](unsigned type, const char *payload, size_t plen)
+                      {
+            if (type == CTRL_ATTR_FAMILY_ID && plen >= sizeof(taskstats_family_))
+                std::memcpy(&taskstats_family_, payload, sizeof(taskstats_family_)); });
+        if (taskstats_family_ == 0)
+            return fail("taskstats family lookup");
+
+        // taskstats queries need CAP_NET_ADMIN; probe with our own pid
+        uid_t probe = 0;
+        if (!query_uid(static_cast<int>(::getpid()), probe))
+        {
+            errno = EPERM;
+            return fail("taskstats query");
+        }
+    }
+
+    // proc connector: join the CN_IDX_PROC group and ask for events
+    events_fd_ = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+    if (events_fd_ < 0)
+        return fail("proc connector socket");
+
+    sockaddr_nl addr{};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    if (::bind(events_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        return fail("proc connector bind");
+
+    char req[nlmsg_hdrlen + sizeof(cn_msg) + sizeof(proc_cn_mcast_op)] = {};
+    nlmsghdr nlh{};
+    nlh.nlmsg_len = sizeof(req);
+    nlh.nlmsg_type = NLMSG_DONE;
+    nlh.nlmsg_pid = static_cast<unsigned int>(::getpid());
+    cn_msg cn{};
+    cn.id.idx = CN_IDX_PROC;
+    cn.id.val = CN_VAL_PROC;
+    cn.len = sizeof(proc_cn_mcast_op);
+    proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+    std::memcpy(req, &nlh, sizeof(nlh));
+    std::memcpy(req + nlmsg_hdrlen, &cn, sizeof(cn));
+    std::memcpy(req + nlmsg_hdrlen + sizeof(cn), &op, sizeof(op));
+    if (::send(events_fd_, req, sizeof(req), 0) < 0)
+        return fail("proc connector subscribe");
+
+    // subscribed before listing, so nothing that starts in between is missed
+    resync();
+    return true;
+}
+
+void NetlinkProcessSource::resync()
+{
+    auto pids = list_proc_pids();
+    live_.clear();
+    live_.insert(pids.begin(), pids.end());
+
+    // drop identities of pids that are gone; look the rest up again lazily
+    for (auto it = uids_.begin(); it != uids_.end();)
+        it = live_.count(it->first) ? std::next(it) : uids_.erase(it);
+    stale_ = live_;
+}
+
+void NetlinkProcessSource::drain_events()
+{
+    alignas(nlmsghdr) char buf[16384];
+    for (;;)
+    {
+        ssize_t n = ::recv(events_fd_, buf, sizeof(buf), 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == ENOBUFS)
+            {
+                resync(); // the kernel dropped events; start over from /proc
+                continue;
+            }
+            return; // EAGAIN: nothing pending
+        }
+
+        size_t left = static_cast<size_t>(n);
+        const char *p = buf;
+        while (left >= nlmsg_hdrlen)
+        {
+            nlmsghdr nlh;
+            std::memcpy(&nlh, p, sizeof(nlh));
+            if (nlh.nlmsg_len < nlmsg_hdrlen || nlh.nlmsg_len > left)
+                break;
+
+            if (nlh.nlmsg_len >= nlmsg_hdrlen + sizeof(cn_msg) + sizeof(proc_event))
+            {
+                proc_event ev;
+                std::memcpy(&ev, p + nlmsg_hdrlen + sizeof(cn_msg), sizeof(ev));
+                switch (ev.what)
+                {
+                case proc_event::PROC_EVENT_FORK:
+                    // new threads fork too; only a new thread group is a new process
+                    if (ev.event_data.fork.child_pid == ev.event_data.fork.child_tgid)
+                    {
+                        live_.insert(ev.event_data.fork.child_tgid);
+                        stale_.insert(ev.event_data.fork.child_tgid);
+                    }
+                    break;
+                case proc_event::PROC_EVENT_EXEC:
+                    stale_.insert(ev.event_data.exec.process_tgid);
+                    break;
+                case proc_event::PROC_EVENT_UID:
+                    stale_.insert(ev.event_data.id.process_tgid);
+                    break;
+                case proc_event::PROC_EVENT_EXIT:
+                    if (ev.event_data.exit.process_pid == ev.event_data.exit.process_tgid)
+                    {
+                        live_.erase(ev.event_data.exit.process_tgid);
+                        stale_.erase(ev.event_data.exit.process_tgid);
+                        uids_.erase(ev.event_data.exit.process_tgid);
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            size_t step = std::min(left, align4(nlh.nlmsg_len));
+            p += step;
+            left -= step;
+        }
+    }
+}
+
+bool NetlinkProcessSource::query_uid(int tgid, uid_t &out)
+{
+    // per-pid (not per-tgid) stats: only the aggregate by pid carries ac_uid for
+    // the thread group leader, whose pid equals the tgid
+    auto msg = genl_request(taskstats_family_, TASKSTATS_CMD_GET, TASKSTATS_GENL_VERSION, ++seq_);
+    __u32 pid = static_cast<__u32>(tgid);
+    put_attr(msg, TASKSTATS_CMD_ATTR_PID, &pid, sizeof(pid));
+
+    std::vector<char> reply;
+    const char *attrs = nullptr;
+    size_t len = 0;
+    if (!genl_call(taskstats_fd_, msg, reply, attrs, len))
+        return false;
+
+    bool found = false;
+    for_each_attr(attrs, len, [&](unsigned type, const char *payload, size_t plen)
+                  {
+        if (type != TASKSTATS_TYPE_AGGR_PID)
+            return;
+        for_each_attr(payload, plen, [&](unsigned inner, const char *stats, size_t slen)
+                      {
+            // older kernels send a shorter struct; ac_uid sits in the stable prefix
+            if (inner != TASKSTATS_TYPE_STATS || slen < offsetof(taskstats, ac_uid) + sizeof(__u32))
+                return;
+            __u32 uid = 0;
+            std::memcpy(&uid, stats + offsetof(taskstats, ac_uid), sizeof(uid));
+            out = static_cast<uid_t>(uid);
+            found = true; }); });
+    return found;
+}
+
+const std::vector<int> &NetlinkProcessSource::pids()
+{
+    drain_events();
+
+    for (int tgid : stale_)
+    {
+        uid_t u = 0;
+        if (query_uid(tgid, u))
+            uids_[tgid] = u;
+        else
+            uids_.erase(tgid); // exited before we asked
+    }
+    stale_.clear();
+
+    sorted_.assign(live_.begin(), live_.end());
+    std::sort(sorted_.begin(), sorted_.end());
+    return sorted_;
+}
+
+bool NetlinkProcessSource::uid(int tgid, uid_t &out) const
+{
+    auto it = uids_.find(tgid);
+    if (it == uids_.end())
+        return false;
+    out = it->second;
+    return true;
+}
@@ -1,52 +1,51 @@
 #include "network.hpp"
-#include <fstream>
-#include <sstream>
-#include <thread>
+#include "procfs.hpp"
 #include <chrono>
 #include <unordered_map>
 
 using json = nlohmann::json;
 
-struct RawNet
+std::vector<RawNet> read_raw_net()
 {
-    std::string iface;
-    long rx_bytes;
-    long tx_bytes;
-};
+    thread_local procfs::Buffer buf(4096);
+    if (!buf.load("/proc/net/dev"))
+        return {};
+    return parse_raw_net(buf.view());
+}
 
-static std::vector<RawNet> read_raw_net()
+std::vector<RawNet> parse_raw_net(std::string_view net_dev)
 {
     std::vector<RawNet> interfaces;
-    std::ifstream file("/proc/net/dev");
-    std::string line;
+    procfs::Tokenizer lines(net_dev);
 
     // 2 skip the headers
-    std::getline(file, line);
-    std::getline(file, line);
+    lines.next_line();
+    lines.next_line();
 
-    while (std::getline(file, line))
+    while (!lines.done())
     {
-        std::istringstream iss(line);
+        std::string_view line = lines.next_line();
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+            continue;
+
+        // counters may touch the colon ("eth0:1234"), so split on it first
+        procfs::Tokenizer iss(line.substr(colon + 1));
         RawNet r;
-        std::getline(iss, r.iface, ':');
-        iss >> r.rx_bytes;
-        for (int i = 0; i < 7; ++i)
-            iss >> line; // skippin info
-        iss >> r.tx_bytes;
-
-        // formatting
-        r.iface.erase(0, r.iface.find_first_not_of(" "));
-        interfaces.push_back(r);
+        r.iface = std::string(procfs::trim(line.substr(0, colon)));
+        r.rx_bytes = 0;
+        r.tx_bytes = 0;
+        iss.next(r.rx_bytes);
+        iss.skip(7); // skippin info
+        iss.next(r.tx_bytes);
+
+        interfaces.push_back(std::move(r));
     }
     return interfaces;
 };
 
-std::vector<NetworkStats> get_network_rates()
+std::vector<NetworkStats> network_rates_between(const std::vector<RawNet> &before, const std::vector<RawNet> &after, double seconds)
 {
-    auto before = read_raw_net();
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    auto after = read_raw_net();
-
     std::unordered_map<std::string, RawNet> byName;
     byName.reserve(before.size());
     for (const auto &r : before)
@@ -70,17 +69,44 @@ std::vector<NetworkStats> get_network_rates()
 
         NetworkStats iface;
         iface.interface = r.iface;
-        iface.download_rate = static_cast<double>(drx);
-        iface.upload_rate = static_cast<double>(dtx);
+        iface.download_rate = seconds > 0.0 ? static_cast<double>(drx) / seconds : 0.0;
+        iface.upload_rate = seconds > 0.0 ? static_cast<double>(dtx) / seconds : 0.0;
         results.push_back(iface);
     }
     return results;
 };
 
+std::vector<NetworkStats> get_network_rates()
+{
+    static std::vector<RawNet> prev;
+    static std::chrono::steady_clock::time_point prev_time;
+
+    auto now = std::chrono::steady_clock::now();
+    auto cur = read_raw_net();
+    double seconds = std::chrono::duration<double>(now - prev_time).count();
+
+    std::vector<NetworkStats> results;
+    if (!prev.empty())
+        results = network_rates_between(prev, cur, seconds);
+
+    prev = std::move(cur);
+    prev_time = now;
+    return results;
+};
+
 json network_to_json(const NetworkStats &iface)
 {
     return {
         {"interface", iface.interface},
         {"upload_rate_bytes_per_sec", iface.upload_rate},
         {"download_rate_bytes_per_sec", iface.download_rate}};
-};
\ No newline at end of file
+};
+
+NetworkStats network_from_json(const json &j)
+{
+    NetworkStats iface;
+    iface.interface = j.value("interface", std::string());
+    iface.upload_rate = j.value("upload_rate_bytes_per_sec", 0.0);
+    iface.download_rate = j.value("download_rate_bytes_per_sec", 0.0);
+    return iface;
+}
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include "process_table.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+
+NameId NamePool::intern(std::string_view name)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(name);
+        if (it != ids_.end())
+            return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = ids_.find(name); // another thread may have added it meanwhile
+    if (it != ids_.end())
+        return it->second;
+    NameId id = static_cast<NameId>(names_.size());
+    ids_.emplace(names_.emplace_back(name), id);
+    return id;
+}
+
+const std::string &NamePool::name(NameId id) const
+{
+    static const std::string empty;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return id < names_.size() ? names_[id] : empty;
+}
+
+NamePool &process_names()
+{
+    static NamePool pool;
+    return pool;
+}
+
+void ProcessTable::clear()
+{
+    pid.clear();
+    cpu_usage.clear();
+    cpu_time.clear();
+    memory_kb.clear();
+    memory_percent.clear();
+    threads.clear();
+    state.clear();
+    name.clear();
+    user.clear();
+}
+
+void ProcessTable::reserve(std::size_t n)
+{
+    pid.reserve(n);
+    cpu_usage.reserve(n);
+    cpu_time.reserve(n);
+    memory_kb.reserve(n);
+    memory_percent.reserve(n);
+    threads.reserve(n);
+    state.reserve(n);
+    name.reserve(n);
+    user.reserve(n);
+}
+
+void ProcessTable::push_back(const ProcessInfo &p)
+{
+    pid.push_back(p.pid);
+    cpu_usage.push_back(p.cpu.cpu_usage);
+    cpu_time.push_back(p.cpu.cpu_time);
+    memory_kb.push_back(p.memory_usage);
+    memory_percent.push_back(p.memory_percent);
+    threads.push_back(p.threads);
+    state.push_back(p.state);
+    name.push_back(process_names().intern(p.process_name));
+    user.push_back(p.user);
+}
+
+void ProcessTable::assign(const std::vector<ProcessInfo> &processes)
+{
+    clear();
+    reserve(processes.size());
+    for (const auto &p : processes)
+        push_back(p);
+}
+
+bool parse_process_order(std::string_view spec, std::vector<ProcessSortKey> &keys, std::string *err)
+{
+    std::vector<ProcessSortKey> out;
+    while (!spec.empty())
+    {
+        size_t comma = spec.find(',');
+        std::string_view name = spec.substr(0, comma);
+        spec = (comma == std::string_view::npos) ? std::string_view() : spec.substr(comma + 1);
+
+        if (name == "cpu")
+            out.push_back(ProcessSortKey::Cpu);
+        else if (name == "mem")
+            out.push_back(ProcessSortKey::Memory);
+        else if (name == "threads")
+            out.push_back(ProcessSortKey::Threads);
+        else if (name == "time")
+            out.push_back(ProcessSortKey::CpuTime);
+        else if (name == "pid")
+            out.push_back(ProcessSortKey::Pid);
+        else if (name == "name")
+            out.push_back(ProcessSortKey::Name);
+        else
+        {
+            if (err)
+                *err = "unknown sort key '" + std::string(name) + "'";
+            return false;
+        }
+    }
+
+    if (out.empty())
+    {
+        if (err)
+            *err = "empty sort order";
+        return false;
+    }
+    keys = std::move(out);
+    return true;
+}
+
+const char *process_sort_key_name(ProcessSortKey key)
+{
+    switch (key)
+    {
+    case ProcessSortKey::Cpu:
+        return "cpu";
+    case ProcessSortKey::Memory:
+        return "mem";
+    case ProcessSortKey::Threads:
+        return "threads";
+    case ProcessSortKey::CpuTime:
+        return "time";
+    case ProcessSortKey::Pid:
+        return "pid";
+    case ProcessSortKey::Name:
+        return "name";
+    }
+    return "";
+}
+
+// rank of each NameId in alphabetical order, so the name key compares integers
+static std::vector<std::uint32_t> name_ranks(const ProcessTable &t)
+{
+    NameId max_id = 0;
+    for (NameId id : t.name)
+        max_id = std::max(max_id, id);
+
+    // resolve each distinct name once; the pool takes a lock per lookup
+    std::vector<std::uint32_t> rank(t.size() ? max_id + 1 : 0);
+    std::vector<bool> seen(rank.size());
+    std::vector<std::pair<std::string_view, NameId>> names;
+    for (NameId id : t.name)
+    {
+        if (seen[id])
+            continue;
+        seen[id] = true;
+        names.emplace_back(process_names().name(id), id);
+    }
+    std::sort(names.begin(), names.end());
+
+    for (std::uint32_t r = 0; r < names.size(); ++r)
+        rank[names[r].second] = r;
+    return rank;
+}
+
+namespace
+{
+    // strict weak order of table rows under a list of sort keys, pid breaking ties
+    struct RowOrder
+    {
+        const ProcessTable &t;
+        const std::vector<ProcessSortKey> &keys;
+        std::vector<std::uint32_t> by_name;
+
+        RowOrder(const ProcessTable &table, const std::vector<ProcessSortKey> &sort_keys) : t(table), keys(sort_keys)
+        {
+            if (std::find(keys.begin(), keys.end(), ProcessSortKey::Name) != keys.end())
+                by_name = name_ranks(t);
+        }
+
+        // negative: a before b, positive: b before a
+        int compare(ProcessSortKey key, std::uint32_t a, std::uint32_t b) const
+        {
+            auto desc = [](auto x, auto y)
+            { return x > y ? -1 : (x < y ? 1 : 0); };
+            switch (key)
+            {
+            case ProcessSortKey::Cpu:
+                return desc(t.cpu_usage[a], t.cpu_usage[b]);
+            case ProcessSortKey::Memory:
+                return desc(t.memory_percent[a], t.memory_percent[b]);
+            case ProcessSortKey::Threads:
+                return desc(t.threads[a], t.threads[b]);
+            case ProcessSortKey::CpuTime:
+                return desc(t.cpu_time[a], t.cpu_time[b]);
+            case ProcessSortKey::Pid:
+                return -desc(t.pid[a], t.pid[b]);
+            case ProcessSortKey::Name:
+                return -desc(by_name[t.name[a]], by_name[t.name[b]]);
+            }
+            return 0;
+        }
+
+        bool operator()(std::uint32_t a, std::uint32_t b) const
+        {
+            for (ProcessSortKey key : keys)
+                if (int c = compare(key, a, b))
+                    return c < 0;
+            return t.pid[a] < t.pid[b];
+        }
+    };
+
+    std::vector<std::uint32_t> candidate_rows(const ProcessTable &t, const std::vector<std::uint32_t> *rows)
+    {
+        if (rows)
+            return *rows;
+        std::vector<std::uint32_t> all(t.size());
+        std::iota(all.begin(), all.end(), 0u);
+        return all;
+    }
+}
+
+std::vector<std::uint32_t> rank_processes(const ProcessTable &t, const std::vector<ProcessSortKey> &keys, std::size_t limit,
+                                          const std::vector<std::uint32_t> *rows)
+{
+    return rank_window(t, keys, 0, limit, rows);
+}
+
+std::vector<std::uint32_t> rank_window(const ProcessTable &t, const std::vector<ProcessSortKey> &keys, std::size_t offset, std::size_t count,
+                                       const std::vector<std::uint32_t> *rows)
+{
+    std::vector<std::uint32_t> order = candidate_rows(t, rows);
+    RowOrder before(t, keys);
+
+    // two partitions put exactly the window's rows in [begin, end); only those get sorted
+    std::size_t begin = std::min(offset, order.size());
+    std::size_t end = begin + std::min(count, order.size() - begin);
+    if (begin > 0)
+        std::nth_element(order.begin(), order.begin() + begin, order.end(), before);
+    if (end < order.size())
+        std::nth_element(order.begin() + begin, order.begin() + end, order.end(), before);
+    std::sort(order.begin() + begin, order.begin() + end, before);
+
+    return std::vector<std::uint32_t>(order.begin() + begin, order.begin() + end);
+}
+
+std::size_t process_rank(const ProcessTable &t, const std::vector<ProcessSortKey> &keys, std::uint32_t row,
+                         const std::vector<std::uint32_t> *rows)
+{
+    RowOrder before(t, keys);
+    std::size_t rank = 0;
+    if (rows)
+    {
+        for (std::uint32_t r : *rows)
+            rank += before(r, row);
+    }
+    else
+    {
+        for (std::uint32_t r = 0; r < t.size(); ++r)
+            rank += before(r, row);
+    }
+    return rank;
+}
+
+std::size_t find_process(const ProcessTable &t, int pid)
+{
+    return static_cast<std::size_t>(std::find(t.pid.begin(), t.pid.end(), pid) - t.pid.begin());
+}
+
+std::vector<std::uint32_t> filter_processes(const ProcessTable &t, std::string_view needle)
+{
+    std::vector<std::uint32_t> rows;
+    rows.reserve(t.size());
+
+    // test each distinct name once rather than once per row
+    std::unordered_map<NameId, bool> matches;
+    for (std::uint32_t i = 0; i < t.size(); ++i)
+    {
+        auto [it, inserted] = matches.emplace(t.name[i], false);
+        if (inserted)
+            it->second = needle.empty() || process_names().name(t.name[i]).find(needle) != std::string::npos;
+        if (it->second)
+            rows.push_back(i);
+    }
+    return rows;
+}
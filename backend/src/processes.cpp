@@ -1,10 +1,10 @@
 #include "processes.hpp"
 #include "memory.hpp"
 #include "cpu.hpp"
+#include "procfs.hpp"
 
+#include <atomic>
 #include <filesystem>
-#include <fstream>
-#include <sstream>
 #include <unordered_map>
 #include <thread>
 #include <chrono>
@@ -13,7 +13,6 @@
 #include <cerrno>
 #include <cstring>
 
-#include <pwd.h>
 #include <unistd.h>
 #include <sys/types.h>
 
@@ -21,205 +20,107 @@ using json = nlohmann::json;
 namespace fs = std::filesystem;
 
 // HELPERS
-std::string get_username_from_uid(uid_t uid)
+const std::string &user_name(const ProcessInfo &p)
 {
-    struct passwd *pwd = getpwuid(uid);
-    return pwd ? std::string(pwd->pw_name) : "unknown";
+    return user_cache().name(p.user);
 }
 
-std::string get_process_name(int pid)
+std::string process_status_name(char state)
 {
-    std::ifstream comm("/proc/" + std::to_string(pid) + "/comm");
-    std::string name;
-    getline(comm, name);
-    return name;
-}
-
-// per process, we wanna see which user the process is running for
-uid_t get_process_uid(int pid)
-{
-    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
-    std::string key;
-    uid_t uid = -1;
-    while (status >> key)
+    switch (state)
     {
-        if (key == "Uid:")
-        {
-            status >> uid;
-            break;
-        }
+    case 'R':
+        return "Running";
+    case 'S':
+        return "Sleeping";
+    case 'Z':
+        return "Zombie";
+    case 'T':
+        return "Traced or Stopped";
+    case 'D':
+        return "Sleeping, Uninterruptable";
+    default:
+        return "Unknown";
     }
-    return uid;
 }
 
-// per process, we require memory usage
-long get_process_memory_usage(int pid)
+// parse /proc/<pid>/stat: name, state, threads, utime+stime (jiffies), start time and rss
+static bool parse_stat(std::string_view s, ProcessInfo &p, long &jiffies, unsigned long long &start_time, long &rss_pages)
 {
-    // Try /proc/<pid>/status VmRSS
-    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
-    long rss_kb = 0;
-
-    if (status.is_open())
-    {
-        std::string line;
-        while (std::getline(status, line))
-        {
-            if (line.rfind("VmRSS:", 0) == 0)
-            {
-                // After "VmRSS:" expect "<num> kB"
-                std::istringstream iss(line.substr(6));
-                long val = 0;
-                std::string unit;
-                if (iss >> val >> unit)
-                {
-                    rss_kb = val; // already kB
-                }
-                break;
-            }
-        }
-    }
-
-    // Fallback: /proc/<pid>/statm resident pages * page_size
-    if (rss_kb == 0)
-    {
-        std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
-        long size_pages = 0, resident_pages = 0;
-        if (statm >> size_pages >> resident_pages)
-        {
-            long page_kb = sysconf(_SC_PAGESIZE) / 1024;
-            rss_kb = resident_pages * page_kb;
-        }
-    }
+    // comm may itself contain spaces or ')' so bound it by the first '(' and last ')'
+    size_t lparen = s.find('(');
+    size_t rparen = s.rfind(')');
+    if (lparen == std::string_view::npos || rparen == std::string_view::npos || rparen < lparen || rparen + 2 >= s.size())
+        return false;
 
-    return rss_kb;
-}
+    p.process_name.assign(s.substr(lparen + 1, rparen - lparen - 1));
+    p.state = s[rparen + 2];
+    p.status = process_status_name(p.state);
 
-int get_thread_count(int pid)
-{
-    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
-    std::string key;
-    int threads = 0;
-    while (status >> key)
+    // fields 4..24 are all integers; keep utime (14), stime (15), num_threads (20),
+    // starttime (22) and rss (24)
+    procfs::Tokenizer iss(s.substr(rparen + 3));
+    long long val = 0, utime = 0, stime = 0;
+    for (int field = 4; field <= 24; ++field)
     {
-        if (key == "Threads:")
-        {
-            status >> threads;
-            break;
-        }
-    }
-    return threads;
-}
-
-double get_process_cpu_time(int pid)
-{
-    std::ifstream statFile("/proc/" + std::to_string(pid) + "/stat");
-    if (!statFile.is_open())
-        return 0.0;
-
-    std::string line;
-    std::getline(statFile, line);
-    if (line.empty())
-        return 0.0;
-
-    size_t rparen = line.rfind(')');
-    if (rparen == std::string::npos)
-        return 0.0;
-
-    std::string after = line.substr(rparen + 2); // skip ") "
-    std::istringstream iss(after);
-
-    // field 3 is a char, not a number
-    char stateChar = '\0';
-    if (!(iss >> stateChar))
-        return 0.0;
-
-    // go over fields 4..15 as integers and pick 14/15 (utime/stime)
-    long val = 0, utime = 0, stime = 0;
-    for (int field = 4; field <= 15; ++field)
-    {
-        if (!(iss >> val))
-            return 0.0;
+        if (!iss.next(val))
+            return false;
         if (field == 14)
             utime = val;
         else if (field == 15)
             stime = val;
+        else if (field == 20)
+            p.threads = static_cast<int>(val);
+        else if (field == 22)
+            start_time = static_cast<unsigned long long>(val);
+        else if (field == 24)
+            rss_pages = static_cast<long>(val);
     }
-
-    long ticks = sysconf(_SC_CLK_TCK);
-    return ticks > 0 ? static_cast<double>(utime + stime) / static_cast<double>(ticks) : 0.0;
+    jiffies = static_cast<long>(utime + stime);
+    return true;
 }
 
-std::string get_process_status(int pid)
+// fill every ProcessInfo field for pid from one read of stat and one of status
+// uid is returned rather than resolved: getpwuid is not safe to call from scan workers
+// with known_uid (netlink backend) status is skipped and RSS comes from stat alone
+static bool read_process(int pid, procfs::Buffer &buf, ProcessInfo &p, long &jiffies, unsigned long long &start_time, uid_t &uid, const uid_t *known_uid = nullptr)
 {
-    static const std::unordered_map<std::string, std::string> status_map = {
-        {"R", "Running"},
-        {"S", "Sleeping"},
-        {"Z", "Zombie"},
-        {"T", "Traced or Stopped"},
-        {"D", "Sleeping, Uninterruptable"}};
+    char path[64];
+    long rss_pages = 0;
 
-    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
-    std::string key, process_status = "Unknown";
+    p.pid = pid;
+    p.threads = 0;
+    if (!buf.load(procfs::pid_path(path, pid, "stat")) || !parse_stat(buf.view(), p, jiffies, start_time, rss_pages))
+        return false;
 
-    while (status >> key)
+    uid = known_uid ? *known_uid : static_cast<uid_t>(-1);
+    p.memory_usage = -1;
+    if (!known_uid && buf.load(procfs::pid_path(path, pid, "status")))
     {
-        if (key == "State:")
-        {
-            status >> process_status;
-            break;
-        }
+        // "Uid:" lists real, effective, saved and fs ids; the first is the owner
+        procfs::Tokenizer(procfs::find_key(buf.view(), "Uid")).next(uid);
+        procfs::Tokenizer(procfs::find_key(buf.view(), "VmRSS")).next(p.memory_usage); // already kB
     }
 
-    auto it = status_map.find(process_status);
-    return (it != status_map.end()) ? it->second : "Unknown";
-}
+    // kernel threads have no VmRSS; fall back to the rss page count from stat
+    // (the same counter VmRSS reports)
+    if (p.memory_usage < 0)
+        p.memory_usage = rss_pages * (sysconf(_SC_PAGESIZE) / 1024);
 
-static long read_total_jiffies()
-{
-    std::ifstream f("/proc/stat");
-    std::string line;
-    if (!std::getline(f, line))
-        return 0;
-    std::istringstream iss(line);
-    std::string cpu;
-    long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0, guest = 0, guest_nice = 0;
-    iss >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal >> guest >> guest_nice;
-    return user + nice + system + idle + iowait + irq + softirq + steal + guest + guest_nice;
+    long ticks = sysconf(_SC_CLK_TCK);
+    p.cpu.cpu_time = ticks > 0 ? static_cast<double>(jiffies) / static_cast<double>(ticks) : 0.0;
+    p.cpu.cpu_usage = 0.0; // filled by the tracker against the previous sample
+    p.memory_percent = 0.0;
+    return true;
 }
 
-static long read_process_jiffies(int pid)
+// fields that need the (single-threaded) user lookup
+static void resolve_user(ProcessInfo &p, uid_t uid)
 {
-    std::ifstream statFile("/proc/" + std::to_string(pid) + "/stat");
-    if (!statFile.is_open())
-        return 0;
-    std::string line;
-    std::getline(statFile, line);
-    if (line.empty())
-        return 0;
-
-    size_t rparen = line.rfind(')');
-    if (rparen == std::string::npos)
-        return 0;
-
-    std::string after = line.substr(rparen + 2); // skip ") "
-    std::istringstream iss(after);
-
-    // field 3 is a char
-    char stateChar = '\0';
-    if (!(iss >> stateChar))
-        return 0;
-
-    long val = 0, utime = 0, stime = 0;
-    for (int field = 4; field <= 15; ++field)
-    {
-        if (!(iss >> val))
-            return 0;
-        if (field == 14)
-            utime = val;
-        else if (field == 15)
-            stime = val;
-    }
-    return utime + stime;
+    p.user = user_cache().lookup(uid);
+    p.type = (user_name(p) == "root" || p.process_name.find('d') != std::string::npos)
+                 ? "background process"
+                 : "app";
 }
 
 bool kill_process(int pid, int sig, std::string *error_msg)
@@ -241,117 +142,145 @@ bool kill_process(int pid, int sig, std::string *error_msg)
 }
 
 // MAIN
-std::vector<ProcessInfo> get_all_processes()
+ProcessTracker::ProcessTracker(int collector_threads, ProcessBackend backend)
+    : shards_(static_cast<size_t>(std::clamp(collector_threads, 1, MAX_COLLECTOR_THREADS))),
+      pool_(std::make_unique<WorkerPool>(static_cast<int>(shards_.size())))
 {
-    std::vector<ProcessInfo> processes;
-
-    // t0
-    long total0 = read_total_jiffies();
-    std::unordered_map<int, long> proc0;
-
-    for (const auto &entry : fs::directory_iterator("/proc"))
+    if (backend == ProcessBackend::Netlink)
     {
-        if (!entry.is_directory())
-            continue;
-
-        std::string dirname = entry.path().filename();
-        if (!std::all_of(dirname.begin(), dirname.end(), ::isdigit))
-            continue;
-
-        int pid = std::stoi(dirname);
-
-        ProcessInfo p;
-        p.pid = pid;
-        p.process_name = get_process_name(pid);
-        p.status = get_process_status(pid);
-        p.memory_usage = get_process_memory_usage(pid); // kB (with fallback)
-        p.threads = get_thread_count(pid);
-        p.cpu.cpu_time = get_process_cpu_time(pid); // seconds (safe parse)
-        p.cpu.cpu_usage = 0.0;                      // filled after t1
-        p.user = get_username_from_uid(get_process_uid(pid));
-
-        p.type = (p.user == "root" || p.process_name.find('d') != std::string::npos)
-                     ? "background process"
-                     : "app";
-
-        processes.push_back(p);
-        proc0[pid] = read_process_jiffies(pid);
+        netlink_ = std::make_unique<NetlinkProcessSource>();
+        if (!netlink_->open(&backend_error_))
+            netlink_.reset(); // unprivileged: keep scanning /proc
     }
+}
 
-    // longer window helps on idle systems/WSL
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+ProcessTracker::~ProcessTracker() = default;
+
+std::vector<ProcessInfo> ProcessTracker::refresh()
+{
+    auto times = read_cpu_times();
+    return refresh(times.empty() ? 0 : times[0].total, read_meminfo().mem_total, get_no_logical_processors());
+}
 
-    // t1
-    long total1 = read_total_jiffies();
-    long delta_total = total1 - total0;
+std::vector<ProcessInfo> ProcessTracker::refresh(long total, long mem_total_kb, int ncpu)
+{
+    long delta_total = total - prev_total_;
     if (delta_total < 1)
         delta_total = 1;
+    const bool have_prev = prev_total_ > 0;
+    prev_total_ = total;
 
-    std::vector<ProcessInfo> alive;
-    alive.reserve(processes.size());
-
-    // MemTotal for memory%
-    long mem_total_kb = get_mem_value("MemTotal:");
-    if (mem_total_kb <= 0)
+    pids_.clear();
+    if (netlink_)
+    {
+        pids_ = netlink_->pids(); // kept current by process events
+    }
+    else
     {
-        // fallback to /proc/meminfo if memory.hpp couldn’t read it
-        std::ifstream meminfo("/proc/meminfo");
-        std::string key, unit;
-        long val = 0;
-        while (meminfo >> key >> val >> unit)
+        for (const auto &entry : fs::directory_iterator("/proc"))
         {
-            if (key == "MemTotal:")
-            {
-                mem_total_kb = val;
-                break;
-            }
+            if (!entry.is_directory())
+                continue;
+
+            std::string dirname = entry.path().filename();
+            if (!std::all_of(dirname.begin(), dirname.end(), ::isdigit))
+                continue;
+
+            pids_.push_back(std::stoi(dirname));
         }
     }
 
-    long ticks = sysconf(_SC_CLK_TCK);
+    // workers claim small chunks of the pid list from a shared cursor, so a shard
+    // stuck on a slow pid doesn't hold up the rest; each writes only its own Shard
+    // and reads prev_ without modifying it, so the hot path takes no locks
+    constexpr size_t chunk = 32;
+    std::atomic<size_t> next{0};
+    pool_->run([&](int worker)
+               {
+        Shard &shard = shards_[static_cast<size_t>(worker)];
+        shard.processes.clear();
+        shard.samples.clear();
+        shard.uids.clear();
+
+        for (size_t begin = next.fetch_add(chunk); begin < pids_.size(); begin = next.fetch_add(chunk))
+        {
+            size_t end = std::min(begin + chunk, pids_.size());
+            for (size_t i = begin; i < end; ++i)
+            {
+                int pid = pids_[i];
+                ProcessInfo p;
+                Sample cur{0, 0};
+                uid_t uid = 0, known = 0;
+                const bool have_uid = netlink_ && netlink_->uid(pid, known);
+                if (!read_process(pid, shard.buf, p, cur.jiffies, cur.start_time, uid, have_uid ? &known : nullptr))
+                    continue; // exited while scanning
+
+                // only diff against the previous sample if it is the same process:
+                // a reused pid has a different start time
+                long delta_proc = 0;
+                if (auto it = prev_.find(pid); have_prev && it != prev_.end() && it->second.start_time == cur.start_time)
+                    delta_proc = cur.jiffies - it->second.jiffies;
+                if (delta_proc < 0)
+                    delta_proc = 0;
+
+                // CPU% over the interval since the last refresh
+                double cpu_pct = 100.0 * static_cast<double>(delta_proc) / static_cast<double>(delta_total) * static_cast<double>(ncpu > 0 ? ncpu : 1);
+                if (cpu_pct < 0.0)
+                    cpu_pct = 0.0;
+                if (cpu_pct > 100.0)
+                    cpu_pct = 100.0;
+                p.cpu.cpu_usage = cpu_pct;
+
+                // Memory%
+                p.memory_percent = (mem_total_kb > 0)
+                                       ? 100.0 * static_cast<double>(p.memory_usage) / static_cast<double>(mem_total_kb)
+                                       : 0.0;
+
+                shard.samples.emplace_back(pid, cur);
+                shard.uids.push_back(uid);
+                shard.processes.push_back(std::move(p));
+            }
+        } });
+
+    // merge shards; exited pids drop out of prev_ here
+    user_cache().revalidate();
+    size_t count = 0;
+    for (const auto &shard : shards_)
+        count += shard.processes.size();
 
-    for (auto &p : processes)
+    std::vector<ProcessInfo> processes;
+    processes.reserve(count);
+    std::unordered_map<int, Sample> samples;
+    samples.reserve(count);
+    for (auto &shard : shards_)
     {
-        if (!fs::exists("/proc/" + std::to_string(p.pid)))
+        for (size_t i = 0; i < shard.processes.size(); ++i)
         {
-            continue; // skip exited processes
+            resolve_user(shard.processes[i], shard.uids[i]);
+            processes.push_back(std::move(shard.processes[i]));
         }
+        samples.insert(shard.samples.begin(), shard.samples.end());
+    }
 
-        long j0 = 0;
-        if (auto it = proc0.find(p.pid); it != proc0.end())
-            j0 = it->second;
-
-        long j1 = read_process_jiffies(p.pid);
-        long delta_proc = j1 - j0;
-
-        // if process exited between t0 and t1, keep zeros
-        if (delta_proc < 0)
-            delta_proc = 0;
-
-        long delta_total = total1 - total0;
-        if (delta_total < 1)
-            delta_total = 1;
-
-        // CPU% snapshot over the interval
-        const int ncpu = get_no_logical_processors(); // scale by # processors
-        double cpu_pct = 100.0 * static_cast<double>(delta_proc) / static_cast<double>(delta_total) * static_cast<double>(ncpu > 0 ? ncpu : 1);
-        if (cpu_pct < 0.0)
-            cpu_pct = 0.0;
-        if (cpu_pct > 100.0)
-            cpu_pct = 100.0;
+    // shards finish in any order; keep the output in pid order like a serial scan
+    if (shards_.size() > 1)
+        std::sort(processes.begin(), processes.end(), [](const ProcessInfo &a, const ProcessInfo &b)
+                  { return a.pid < b.pid; });
 
-        p.cpu.cpu_usage = cpu_pct;
-        p.cpu.cpu_time = (ticks > 0) ? static_cast<double>(j1) / static_cast<double>(ticks) : 0.0;
+    prev_ = std::move(samples);
+    return processes;
+}
 
-        // Memory%
-        p.memory_percent = (mem_total_kb > 0)
-                               ? 100.0 * static_cast<double>(p.memory_usage) / static_cast<double>(mem_total_kb)
-                               : 0.0;
+std::vector<ProcessInfo> get_all_processes()
+{
+    ProcessTracker tracker;
+    tracker.refresh();
 
-        alive.push_back(std::move(p));
-    }
+    // one-shot callers have no previous refresh, so take two samples
+    // longer window helps on idle systems/WSL
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
-    return alive;
+    return tracker.refresh();
 }
 
 json process_to_json(const ProcessInfo &p)
@@ -360,7 +289,7 @@ json process_to_json(const ProcessInfo &p)
     j["type"] = p.type;
     j["process_id"] = p.pid;
     j["process_name"] = p.process_name;
-    j["user"] = p.user;
+    j["user"] = user_name(p);
     j["status"] = p.status;
 
     j["cpu"] = {
@@ -375,4 +304,29 @@ json process_to_json(const ProcessInfo &p)
     j["threads"] = p.threads;
 
     return j;
+}
+
+ProcessInfo process_from_json(const json &j)
+{
+    ProcessInfo p;
+    p.type = j.value("type", std::string());
+    p.pid = j.value("process_id", 0);
+    p.process_name = j.value("process_name", std::string());
+    p.user = user_cache().intern(j.value("user", std::string("unknown")));
+    p.status = j.value("status", std::string());
+
+    // the state letter isn't in the JSON; recover it from the status it maps to
+    for (char c : {'R', 'S', 'Z', 'T', 'D'})
+        if (process_status_name(c) == p.status)
+            p.state = c;
+
+    static const json none = json::object();
+    const json &cpu = j.contains("cpu") ? j["cpu"] : none;
+    p.cpu.cpu_usage = cpu.value("cpu_usage", 0.0);
+    p.cpu.cpu_time = cpu.value("cpu_time", 0.0);
+    const json &mem = j.contains("memory") ? j["memory"] : none;
+    p.memory_usage = mem.value("memory_usage_kb", 0L);
+    p.memory_percent = mem.value("memory_percent", 0.0);
+    p.threads = j.value("threads", 0);
+    return p;
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "procfs.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace procfs
+{
+    bool Buffer::load(const char *path)
+    {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            size_ = 0;
+            return false;
+        }
+        bool ok = load(fd);
+        ::close(fd);
+        return ok;
+    }
+
+    bool Buffer::load(int fd)
+    {
+        // /proc files report size 0, so keep reading until EOF and grow on demand
+        size_ = 0;
+        for (;;)
+        {
+            if (size_ == data_.size())
+                data_.resize(data_.size() * 2);
+
+            ssize_t n = ::pread(fd, data_.data() + size_, data_.size() - size_, static_cast<off_t>(size_));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            size_ += static_cast<size_t>(n);
+        }
+        return size_ > 0;
+    }
+
+    File::File(const char *path) : fd_(::open(path, O_RDONLY | O_CLOEXEC)) {}
+
+    File::~File()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    static bool is_space(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n';
+    }
+
+    std::string_view Tokenizer::next()
+    {
+        size_t i = 0;
+        while (i < s_.size() && is_space(s_[i]))
+            ++i;
+        size_t start = i;
+        while (i < s_.size() && !is_space(s_[i]))
+            ++i;
+        std::string_view tok = s_.substr(start, i - start);
+        s_.remove_prefix(i);
+        return tok;
+    }
+
+    bool Tokenizer::skip(int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            if (next().empty())
+                return false;
+        }
+        return true;
+    }
+
+    std::string_view Tokenizer::next_line()
+    {
+        size_t nl = s_.find('\n');
+        std::string_view line = s_.substr(0, nl);
+        s_.remove_prefix(nl == std::string_view::npos ? s_.size() : nl + 1);
+        return line;
+    }
+
+    std::string_view find_key(std::string_view text, std::string_view key)
+    {
+        Tokenizer lines(text);
+        while (!lines.done())
+        {
+            std::string_view line = lines.next_line();
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos || trim(line.substr(0, colon)) != key)
+                continue;
+            return trim(line.substr(colon + 1));
+        }
+        return {};
+    }
+
+    std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    const char *pid_path(char (&out)[64], int pid, const char *file)
+    {
+        std::memcpy(out, "/proc/", 6);
+        char *p = std::to_chars(out + 6, out + 32, pid).ptr;
+        *p++ = '/';
+        size_t len = std::strlen(file);
+        if (len > static_cast<size_t>(out + sizeof(out) - 1 - p))
+            len = static_cast<size_t>(out + sizeof(out) - 1 - p);
+        std::memcpy(p, file, len);
+        p[len] = '\0';
+        return out;
+    }
+}
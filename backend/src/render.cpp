@@ -0,0 +1,70 @@
+#include "render.hpp"
+
+#include <charconv>
+
+namespace render
+{
+    void append_int(std::string &out, long long v)
+    {
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, res.ptr);
+    }
+
+    void append_fixed(std::string &out, double v, int precision)
+    {
+        char buf[64];
+        auto res = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::fixed, precision);
+        if (res.ec == std::errc())
+            out.append(buf, res.ptr);
+        else
+            out += "inf"; // only |v| > 1e60 overflows the buffer
+    }
+
+    std::string fmt_pct(double v)
+    {
+        std::string s;
+        append_fixed(s, v, 1);
+        s += '%';
+        return s;
+    }
+
+    static void append_units(std::string &out, double v, const char *const units[5])
+    {
+        int idx = 0;
+        while (v >= 1024.0 && idx < 4)
+        {
+            v /= 1024.0;
+            ++idx;
+        }
+        append_fixed(out, v, v >= 100 ? 0 : 1);
+        out += ' ';
+        out += units[idx];
+    }
+
+    void append_rate(std::string &out, double bps)
+    {
+        static const char *const units[] = {"B/s", "KB/s", "MB/s", "GB/s", "TB/s"};
+        append_units(out, bps, units);
+    }
+
+    void append_bytes(std::string &out, double bytes)
+    {
+        static const char *const units[] = {"B", "KB", "MB", "GB", "TB"};
+        append_units(out, bytes, units);
+    }
+
+    std::string human_bytes(double bps)
+    {
+        std::string s;
+        append_rate(s, bps);
+        return s;
+    }
+
+    std::string human_bytes_total(double bytes)
+    {
+        std::string s;
+        append_bytes(s, bytes);
+        return s;
+    }
+}
@@ -0,0 +1,174 @@
+#include "replay.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+#include <snapshot.hpp>
+#include <snapshot_binary.hpp>
+
+namespace fs = std::filesystem;
+
+// time encoded in a snapshot::default_filename() name, or -1
+static std::int64_t filename_time_ns(const std::string &name)
+{
+    static const char prefix[] = "buzz-snapshot-";
+    if (name.compare(0, sizeof(prefix) - 1, prefix) != 0)
+        return -1;
+    std::tm tm{};
+    const char *end = strptime(name.c_str() + sizeof(prefix) - 1, "%Y%m%d-%H%M%SZ", &tm);
+    if (!end || (std::strcmp(end, ".json") != 0 && std::strcmp(end, ".bin") != 0))
+        return -1;
+    return static_cast<std::int64_t>(timegm(&tm)) * 1000000000;
+}
+
+static bool is_ring(const std::string &path)
+{
+    char magic[sizeof(history::RING_MAGIC)] = {};
+    std::ifstream f(path, std::ios::binary);
+    return f.read(magic, sizeof(magic)) && std::memcmp(magic, history::RING_MAGIC, sizeof(magic)) == 0;
+}
+
+bool Replay::open(const std::string &path, std::string *err)
+{
+    std::error_code ec;
+    std::string ring = fs::is_directory(path, ec) ? history::ring_path(path) : path;
+    if (fs::is_regular_file(ring, ec) && is_ring(ring))
+    {
+        ring_ = std::make_unique<history::HistoryReader>();
+        if (!ring_->open(ring, err))
+            return false;
+        for (const auto &e : ring_->entries())
+            times_.push_back(e.timestamp_ns);
+    }
+    else if (fs::is_directory(path, ec))
+    {
+        // snapshot files carry their time in the name: the index needs no reads
+        std::vector<std::pair<std::int64_t, std::string>> found;
+        for (const auto &entry : fs::directory_iterator(path, ec))
+        {
+            std::int64_t t = filename_time_ns(entry.path().filename().string());
+            if (t >= 0)
+                found.emplace_back(t, entry.path().string());
+        }
+        std::sort(found.begin(), found.end());
+        for (auto &f : found)
+        {
+            times_.push_back(f.first);
+            files_.push_back(std::move(f.second));
+        }
+    }
+    else if (fs::is_regular_file(path, ec))
+    {
+        // one snapshot: its time is inside, so decode it now
+        files_.push_back(path);
+        times_.push_back(0);
+        std::shared_ptr<const SystemSample> s = load(0, err);
+        if (!s)
+            return false;
+        times_[0] = std::chrono::duration_cast<std::chrono::nanoseconds>(s->timestamp.time_since_epoch()).count();
+        loaded_index_ = 0;
+        loaded_ = std::move(s);
+    }
+
+    if (times_.empty())
+    {
+        if (err)
+            *err = path + ": no recorded samples";
+        return false;
+    }
+
+    // a clock stepped back during recording must not break the binary search
+    for (std::size_t i = 1; i < times_.size(); ++i)
+        times_[i] = std::max(times_[i], times_[i - 1]);
+    index_ = 0;
+    position_ = times_.front();
+    return true;
+}
+
+void Replay::toggle(std::chrono::steady_clock::time_point now)
+{
+    // play from the start again once the end was reached
+    if (!playing_ && index_ + 1 == times_.size())
+        seek(times_.front());
+    playing_ = !playing_;
+    last_wall_ = now;
+}
+
+void Replay::set_speed(int speed, std::chrono::steady_clock::time_point now)
+{
+    advance(now); // time so far counts at the old speed
+    speed_ = std::clamp(speed, 1, 256);
+}
+
+void Replay::seek(std::int64_t t_ns)
+{
+    auto it = std::upper_bound(times_.begin(), times_.end(), t_ns);
+    index_ = it == times_.begin() ? 0 : static_cast<std::size_t>(it - times_.begin()) - 1;
+    position_ = std::max(t_ns, times_.front());
+    position_ = std::min(position_, times_.back());
+}
+
+void Replay::step(long frames)
+{
+    long i = static_cast<long>(index_) + frames;
+    index_ = static_cast<std::size_t>(std::clamp(i, 0L, static_cast<long>(times_.size()) - 1));
+    position_ = times_[index_];
+}
+
+void Replay::advance(std::chrono::steady_clock::time_point now)
+{
+    if (!playing_)
+        return;
+    auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_wall_).count();
+    last_wall_ = now;
+    seek(position_ + wall * speed_);
+    if (index_ + 1 == times_.size())
+        playing_ = false;
+}
+
+int Replay::timeout_ms() const
+{
+    if (!playing_ || index_ + 1 >= times_.size())
+        return -1;
+    std::int64_t wait = (times_[index_ + 1] - position_) / speed_;
+    return static_cast<int>(std::clamp<std::int64_t>(wait / 1000000 + 1, 1, 60000));
+}
+
+std::shared_ptr<const SystemSample> Replay::current(std::string *err)
+{
+    if (loaded_index_ != index_)
+    {
+        std::shared_ptr<const SystemSample> s = load(index_, err);
+        if (!s)
+            return nullptr;
+        loaded_ = std::move(s);
+        loaded_index_ = index_;
+    }
+    return loaded_;
+}
+
+std::shared_ptr<const SystemSample> Replay::load(std::size_t i, std::string *err)
+{
+    auto s = std::make_shared<SystemSample>();
+    if (ring_)
+        return ring_->sample(i, *s, err) ? s : nullptr;
+
+    snapshot::BinarySnapshot b;
+    std::string bin_err;
+    if (b.open(files_[i], &bin_err))
+        return snapshot::to_sample(b, *s, err) ? s : nullptr;
+
+    std::ifstream ifs(files_[i]);
+    nlohmann::json j = nlohmann::json::parse(ifs, nullptr, false);
+    if (j.is_discarded())
+    {
+        if (err)
+            *err = files_[i] + ": not a snapshot";
+        return nullptr;
+    }
+    return snapshot::from_json(j, *s, err) ? s : nullptr;
+}
@@ -0,0 +1,76 @@
+#include "sampler.hpp"
+
+static const ProcessScan NO_PROCESSES;
+
+const std::vector<ProcessInfo> &SystemSample::processes() const
+{
+    return (process_scan ? *process_scan : NO_PROCESSES).processes;
+}
+
+const ProcessTable &SystemSample::process_table() const
+{
+    return (process_scan ? *process_scan : NO_PROCESSES).table;
+}
+
+void SystemSample::set_processes(std::vector<ProcessInfo> processes)
+{
+    auto scan = std::make_shared<ProcessScan>();
+    scan->processes = std::move(processes);
+    scan->table.assign(scan->processes);
+    process_scan = std::move(scan);
+}
+
+// ticks land a little before or after the cadence; a collector that is due
+// within this much still runs now rather than a whole tick late
+constexpr std::chrono::milliseconds SCHEDULE_SLACK{20};
+
+Sampler::Sampler(int collector_threads, ProcessBackend backend, const CollectorConfig &collectors)
+    : processes_(collector_threads, backend)
+{
+    for (const CollectorInfo &info : BUILTIN_COLLECTORS)
+    {
+        CollectorSetting setting;
+        auto it = collectors.find(info.name);
+        if (it != collectors.end())
+            setting = it->second;
+        if (setting.enabled)
+            add(info.make(processes_), setting.interval.count() >= 0 ? setting.interval : info.interval);
+    }
+}
+
+Sampler::~Sampler() = default;
+
+void Sampler::add(std::unique_ptr<Collector> collector, std::chrono::milliseconds interval)
+{
+    collectors_.push_back({std::move(collector), interval, {}, false});
+}
+
+const SystemSample &Sampler::tick()
+{
+    auto now = std::chrono::steady_clock::now();
+    inputs_.begin(now);
+
+    auto next = std::make_shared<SystemSample>();
+    SystemSample &s = *next;
+    s.timestamp = std::chrono::system_clock::now();
+    s.interval_s = primed_ ? std::chrono::duration<double>(now - prev_time_).count() : 0.0;
+
+    for (Slot &slot : collectors_)
+    {
+        if (slot.ran && now + SCHEDULE_SLACK < slot.next)
+        {
+            slot.collector->carry(*sample_, s);
+            continue;
+        }
+        slot.collector->collect(inputs_, s);
+
+        // keep the collector's own cadence; after a stall, restart it from now
+        slot.next = (slot.ran && now < slot.next + slot.interval) ? slot.next + slot.interval : now + slot.interval;
+        slot.ran = true;
+    }
+
+    prev_time_ = now;
+    primed_ = true;
+    sample_ = std::move(next);
+    return *sample_;
+}
@@ -0,0 +1,132 @@
+#include "sampler_thread.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+
+SamplerThread::SamplerThread(int collector_threads, ProcessBackend backend, std::chrono::milliseconds interval,
+                             const CollectorConfig &collectors)
+    : sampler_(collector_threads, backend, collectors),
+      interval_(interval),
+      event_fd_(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+{
+    // without the eventfd nobody would hear about samples
+    if (event_fd_ < 0)
+    {
+        error_ = std::string("eventfd: ") + std::strerror(errno);
+        return;
+    }
+    thread_ = std::thread(&SamplerThread::run, this);
+}
+
+SamplerThread::~SamplerThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+    if (event_fd_ >= 0)
+        ::close(event_fd_);
+}
+
+void SamplerThread::drain()
+{
+    std::uint64_t count;
+    while (::read(event_fd_, &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count)))
+    {
+    }
+}
+
+void SamplerThread::publish()
+{
+    std::atomic_store(&latest_, sampler_.shared_latest());
+    std::uint64_t one = 1;
+    if (event_fd_ >= 0)
+        (void)::write(event_fd_, &one, sizeof(one));
+}
+
+void SamplerThread::run()
+{
+    // prime the rate baselines; a sample taken right after would have rates over a
+    // few milliseconds (0% or 100% CPU), so the first publish waits a whole interval
+    sampler_.tick();
+    auto next = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        // keep the cadence; a scan slower than the interval just runs back to back
+        next = std::max(next + interval_, std::chrono::steady_clock::now());
+        if (wake_.wait_until(lock, next, [this]
+                             { return stop_; }))
+            break;
+
+        lock.unlock();
+        sampler_.tick();
+        publish();
+        lock.lock();
+    }
+}
+
+bool run_until_signal(int collector_threads, ProcessBackend backend, std::chrono::milliseconds interval,
+                      const CollectorConfig &collectors, const std::function<bool(const SystemSample &)> &on_sample,
+                      std::string *err)
+{
+    // block before the collector threads start, as in the TUI
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    int sig_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (sig_fd < 0)
+    {
+        if (err)
+            *err = std::string("signalfd: ") + std::strerror(errno);
+        return false;
+    }
+
+    {
+        SamplerThread collector(collector_threads, backend, interval, collectors);
+        if (!collector.ok())
+        {
+            if (err)
+                *err = collector.error();
+            ::close(sig_fd);
+            return false;
+        }
+        while (true)
+        {
+            pollfd fds[] = {{collector.event_fd(), POLLIN, 0}, {sig_fd, POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            if (fds[1].revents & POLLIN)
+                break;
+
+            if (fds[0].revents & POLLIN)
+            {
+                collector.drain();
+                std::shared_ptr<const SystemSample> sample = collector.latest();
+                if (!on_sample(*sample))
+                    break;
+            }
+        }
+    }
+
+    ::close(sig_fd);
+    return true;
+}
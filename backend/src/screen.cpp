@@ -0,0 +1,177 @@
+#include "screen.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+// runs separated by at most this many unchanged cells are merged: rewriting a
+// few cells is cheaper than the cursor move ("\033[r;cH" is 6-8 bytes)
+static constexpr int MAX_GAP = 6;
+
+// every style starts from a reset so attributes never leak between runs
+static constexpr std::string_view style_codes[] = {
+    "\033[0m",       // Normal
+    "\033[0;2m",     // Dim
+    "\033[0;1;36m",  // Header
+    "\033[0;1;35m",  // Title
+    "\033[0;1;32m",  // Ok
+    "\033[0;1;33m",  // Warn
+    "\033[0;1;31m",  // Err
+    "\033[0;7m",     // Selected
+};
+
+Screen::Screen(int fd, bool color) : fd_(fd), color_(color) {}
+
+void Screen::resize(int rows, int cols)
+{
+    rows = std::max(1, rows);
+    cols = std::max(1, cols);
+    if (rows == rows_ && cols == cols_)
+        return;
+    rows_ = rows;
+    cols_ = cols;
+    back_.assign(static_cast<size_t>(rows_) * cols_, Cell{});
+    front_.assign(back_.size(), Cell{});
+    full_ = true;
+
+    // cursor moves are "\033[" row ";" col "H": keep both halves ready-made
+    row_esc_.resize(static_cast<size_t>(rows_));
+    for (int r = 0; r < rows_; ++r)
+        row_esc_[r] = "\033[" + std::to_string(r + 1) + ";";
+    col_esc_.resize(static_cast<size_t>(cols_));
+    for (int c = 0; c < cols_; ++c)
+        col_esc_[c] = std::to_string(c + 1) + "H";
+
+    // worst case: a style change and a move around every cell of a full redraw
+    out_.reserve(back_.size() * 4 + 64);
+}
+
+void Screen::clear()
+{
+    std::fill(back_.begin(), back_.end(), Cell{});
+    row_ = 0;
+    col_ = 0;
+}
+
+void Screen::move(int row, int col)
+{
+    row_ = std::clamp(row, 0, rows_);
+    col_ = std::clamp(col, 0, cols_);
+}
+
+void Screen::put(char ch, Style style)
+{
+    if (row_ >= rows_ || col_ >= cols_)
+        return;
+    // one byte per cell: control and non-ascii bytes would desync the grid
+    unsigned char u = static_cast<unsigned char>(ch);
+    back_[static_cast<size_t>(row_) * cols_ + col_] = {(u >= 0x20 && u < 0x7f) ? ch : '?', color_ ? style : Normal};
+    ++col_;
+}
+
+void Screen::print(std::string_view text, Style style)
+{
+    for (char ch : text)
+    {
+        if (ch == '\n')
+        {
+            ++row_;
+            col_ = 0;
+            continue;
+        }
+        put(ch, style);
+    }
+}
+
+void Screen::fill(char ch, int count, Style style)
+{
+    for (int i = 0; i < count; ++i)
+        put(ch, style);
+}
+
+size_t Screen::flush()
+{
+    out_.clear();
+
+    int cur_row = -1, cur_col = -1; // terminal cursor, -1 when unknown
+    bool style_known = false;
+    Style cur_style = Normal;
+    if (full_)
+    {
+        out_ += "\033[0m\033[H\033[2J";
+        std::fill(front_.begin(), front_.end(), Cell{});
+        cur_row = cur_col = 0;
+        style_known = true;
+        full_ = false;
+    }
+
+    auto move_to = [&](int r, int c)
+    {
+        if (r == cur_row && c == cur_col)
+            return;
+        out_ += row_esc_[r];
+        out_ += col_esc_[c];
+        cur_row = r;
+        cur_col = c;
+    };
+
+    for (int r = 0; r < rows_; ++r)
+    {
+        const Cell *back = &back_[static_cast<size_t>(r) * cols_];
+        Cell *front = &front_[static_cast<size_t>(r) * cols_];
+        int c = 0;
+        while (c < cols_)
+        {
+            if (back[c] == front[c])
+            {
+                ++c;
+                continue;
+            }
+
+            // extend the run over differing cells and short unchanged gaps
+            int last = c;
+            for (int k = c + 1; k < cols_ && k - last <= MAX_GAP; ++k)
+                if (back[k] != front[k])
+                    last = k;
+
+            move_to(r, c);
+            for (int k = c; k <= last; ++k)
+            {
+                if (!style_known || back[k].style != cur_style)
+                {
+                    out_ += style_codes[back[k].style];
+                    cur_style = back[k].style;
+                    style_known = true;
+                }
+                out_ += back[k].ch;
+                front[k] = back[k];
+            }
+            // writing the last column leaves the terminal in a pending-wrap state
+            cur_col = (last + 1 < cols_) ? last + 1 : -1;
+            c = last + 1;
+        }
+    }
+
+    if (style_known && cur_style != Normal)
+        out_ += style_codes[Normal];
+    move_to(std::min(row_, rows_ - 1), std::min(col_, cols_ - 1));
+
+    last_ = {};
+    size_t off = 0;
+    while (off < out_.size())
+    {
+        ssize_t n = ::write(fd_, out_.data() + off, out_.size() - off);
+        ++last_.writes;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        off += static_cast<size_t>(n);
+    }
+    // front_ already claims the cells of the lost bytes; redraw everything next time
+    if (off < out_.size())
+        full_ = true;
+    last_.bytes = off;
+    total_.bytes += last_.bytes;
+    total_.writes += last_.writes;
+    return off;
+}
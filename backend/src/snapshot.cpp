@@ -3,6 +3,7 @@
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 #include <nlohmann/json.hpp>
@@ -13,16 +14,16 @@
 #include <disk.hpp>
 #include <network.hpp>
 #include <battery.hpp>
+#include <sampler.hpp>
 #include <snapshot.hpp>
 
 using json = nlohmann::json;
 
 namespace snapshot
 {
-    static std::string current_timestamp()
+    std::string format_timestamp(std::chrono::system_clock::time_point tp)
     {
-        auto now = std::chrono::system_clock::now();
-        auto t = std::chrono::system_clock::to_time_t(now);
+        auto t = std::chrono::system_clock::to_time_t(tp);
         std::tm tm{};
         gmtime_r(&t, &tm);
         char buf[32];
@@ -30,72 +31,246 @@ namespace snapshot
         return buf;
     }
 
-    json make()
+    bool parse_sections(std::string_view spec, unsigned &sections, std::string *err)
+    {
+        static const struct
+        {
+            const char *name;
+            unsigned bits;
+        } names[] = {{"cpu", Cpu}, {"cores", Cores}, {"topology", Topology}, {"memory", Memory},
+                     {"processes", Processes}, {"disk", Disk}, {"network", Network}, {"battery", Battery},
+                     {"all", All}};
+
+        unsigned out = 0;
+        while (!spec.empty())
+        {
+            size_t comma = spec.find(',');
+            std::string_view name = spec.substr(0, comma);
+            spec = (comma == std::string_view::npos) ? std::string_view() : spec.substr(comma + 1);
+
+            unsigned bits = 0;
+            for (const auto &n : names)
+                if (name == n.name)
+                    bits = n.bits;
+            if (!bits)
+            {
+                if (err)
+                    *err = "unknown field '" + std::string(name) + "'";
+                return false;
+            }
+            out |= bits;
+        }
+
+        if (!out)
+        {
+            if (err)
+                *err = "empty field list";
+            return false;
+        }
+        sections = out;
+        return true;
+    }
+
+    json to_json(const SystemSample &s, unsigned sections)
     {
         json j;
 
-        // CPU
+        // CPU; per-core rows and topology can be asked for without the totals
+        if (sections & (Cpu | Cores | Topology))
         {
             json cpu_json;
-            double cpu_usage = get_cpu_usage();
-            std::vector<double> per_core = get_per_core_usage();
-            cpu_json["cpu_usage"] = cpu_usage;
-            cpu_json["cpu_name"] = get_cpu_name();
-            cpu_json["running_processes"] = get_running_processes();
-            cpu_json["cpu_frequency"] = get_cpu_frequency();
-            cpu_json["no_of_logical_processors"] = get_no_logical_processors();
-            cpu_json["per_core_usage"] = json::array();
-            for (size_t i = 0; i < per_core.size(); ++i)
-                cpu_json["per_core_usage"].push_back({{"core_id", static_cast<int>(i)},
-                                                      {"usage_percent", per_core[i]}});
+            if (sections & Cpu)
+            {
+                cpu_json["cpu_usage"] = s.cpu_usage;
+                cpu_json["cpu_name"] = s.cpu_name;
+                cpu_json["running_processes"] = s.running_processes;
+                cpu_json["cpu_frequency"] = s.cpu_frequency;
+                cpu_json["no_of_logical_processors"] = s.logical_processors;
+            }
+            if (sections & Cores)
+                cpu_json["per_core_usage"] = json::array();
+            for (size_t i = 0; (sections & Cores) && i < s.per_core_usage.size(); ++i)
+            {
+                json core = {{"core_id", static_cast<int>(i)},
+                             {"usage_percent", s.per_core_usage[i]}};
+                if (i < s.per_core_frequency.size())
+                    core["frequency_mhz"] = s.per_core_frequency[i];
+                cpu_json["per_core_usage"].push_back(std::move(core));
+            }
+            if ((sections & Topology) && s.topology)
+            {
+                json caches = json::array();
+                for (const auto &c : s.topology->caches)
+                    caches.push_back({{"level", c.level}, {"type", c.type}, {"size_kb", c.size_kb}});
+                cpu_json["topology"] = {
+                    {"physical_cores", s.topology->physical_cores},
+                    {"sockets", s.topology->sockets},
+                    {"numa_nodes", s.topology->numa_nodes},
+                    {"threads_per_core", s.topology->threads_per_core},
+                    {"caches", std::move(caches)}};
+            }
             j["cpu"] = std::move(cpu_json);
         }
 
         // Memory
+        if (sections & Memory)
         {
             json mem_json;
-            mem_json["memory_usage"] = get_memory_usage();
-            mem_json["cached_memory"] = get_mem_value("Cached:");
-            mem_json["free_swappable_memory"] = get_mem_value("SwapFree:");
-            mem_json["total_swappable_memory"] = get_mem_value("SwapTotal:");
+            mem_json["memory_usage"] = s.memory_usage;
+            mem_json["cached_memory"] = s.memory.cached;
+            mem_json["free_swappable_memory"] = s.memory.swap_free;
+            mem_json["total_swappable_memory"] = s.memory.swap_total;
+            mem_json["meminfo"] = meminfo_to_json(s.memory);
             j["memory"] = std::move(mem_json);
         }
 
         // Processes
+        if (sections & Processes)
         {
             json proc_json;
-            auto processes = get_all_processes();
-            for (const auto &p : processes)
+            for (const auto &p : s.processes())
                 proc_json["processes"].push_back(process_to_json(p));
             j["process_info"] = std::move(proc_json);
         }
 
         // Disk
+        if (sections & Disk)
         {
             json disk_json;
-            auto disks = get_disk_stats();
-            for (const auto &d : disks)
+            for (const auto &d : s.disks)
                 disk_json["disks"].push_back(disk_to_json(d));
             j["disk"] = std::move(disk_json);
         }
 
         // Battery
-        j["battery"] = battery_to_json(get_battery_info());
+        if (sections & Battery)
+            j["battery"] = battery_to_json(s.battery);
 
         // Network
+        if (sections & Network)
         {
             json net_json;
-            auto net_stats = get_network_rates();
-            for (const auto &iface : net_stats)
+            for (const auto &iface : s.network)
                 net_json["interfaces"].push_back(network_to_json(iface));
             j["network"] = std::move(net_json);
         }
 
-        j["timestamp"] = current_timestamp();
+        j["timestamp"] = format_timestamp(s.timestamp);
         return j;
     }
 
-    std::string default_filename()
+    static bool parse_timestamp(const std::string &text, std::chrono::system_clock::time_point &tp)
+    {
+        std::tm tm{};
+        const char *end = strptime(text.c_str(), "%Y-%m-%dT%H:%M:%SZ", &tm);
+        if (!end || *end)
+            return false;
+        tp = std::chrono::system_clock::from_time_t(timegm(&tm));
+        return true;
+    }
+
+    bool from_json(const json &j, SystemSample &s, std::string *err)
+    {
+        if (!j.is_object())
+        {
+            if (err)
+                *err = "snapshot is not a JSON object";
+            return false;
+        }
+
+        try
+        {
+            SystemSample out;
+            static const json none = json::object();
+            auto section = [&](const char *key) -> const json &
+            {
+                auto it = j.find(key);
+                return (it != j.end() && it->is_object()) ? *it : none;
+            };
+            auto rows = [](const json &parent, const char *key) -> const json &
+            {
+                static const json empty = json::array();
+                auto it = parent.find(key);
+                return (it != parent.end() && it->is_array()) ? *it : empty;
+            };
+
+            if (!parse_timestamp(j.value("timestamp", std::string()), out.timestamp))
+            {
+                if (err)
+                    *err = "missing or malformed timestamp";
+                return false;
+            }
+
+            const json &cpu = section("cpu");
+            out.cpu_usage = cpu.value("cpu_usage", 0.0);
+            out.cpu_name = cpu.value("cpu_name", std::string());
+            out.running_processes = cpu.value("running_processes", 0LL);
+            out.cpu_frequency = cpu.value("cpu_frequency", 0.0);
+            out.logical_processors = cpu.value("no_of_logical_processors", 0);
+            for (const auto &core : rows(cpu, "per_core_usage"))
+            {
+                out.per_core_usage.push_back(core.value("usage_percent", 0.0));
+                if (core.contains("frequency_mhz"))
+                    out.per_core_frequency.push_back(core.value("frequency_mhz", 0.0));
+            }
+            if (cpu.contains("topology") && cpu["topology"].is_object())
+            {
+                const json &t = cpu["topology"];
+                auto topo = std::make_shared<CpuTopology>();
+                topo->model_name = out.cpu_name;
+                topo->logical_cpus = out.logical_processors;
+                topo->physical_cores = t.value("physical_cores", 0);
+                topo->sockets = t.value("sockets", 0);
+                topo->numa_nodes = t.value("numa_nodes", 0);
+                topo->threads_per_core = t.value("threads_per_core", 1);
+                for (const auto &c : rows(t, "caches"))
+                    topo->caches.push_back({c.value("level", 0), c.value("type", std::string()), c.value("size_kb", 0L)});
+                out.topology = std::move(topo);
+            }
+
+            const json &mem = section("memory");
+            out.memory_usage = mem.value("memory_usage", 0.0);
+            if (mem.contains("meminfo"))
+                out.memory = meminfo_from_json(mem["meminfo"]);
+            else
+            {
+                // snapshots from before meminfo only carry these three
+                out.memory.cached = mem.value("cached_memory", 0L);
+                out.memory.swap_free = mem.value("free_swappable_memory", 0L);
+                out.memory.swap_total = mem.value("total_swappable_memory", 0L);
+            }
+
+            std::vector<ProcessInfo> processes;
+            for (const auto &p : rows(section("process_info"), "processes"))
+                processes.push_back(process_from_json(p));
+            out.set_processes(std::move(processes));
+            for (const auto &d : rows(section("disk"), "disks"))
+                out.disks.push_back(disk_from_json(d));
+            for (const auto &iface : rows(section("network"), "interfaces"))
+                out.network.push_back(network_from_json(iface));
+            out.battery = battery_from_json(section("battery"));
+
+            s = std::move(out);
+            return true;
+        }
+        catch (const json::exception &e)
+        {
+            if (err)
+                *err = std::string("malformed snapshot: ") + e.what();
+            return false;
+        }
+    }
+
+    json make()
+    {
+        // one shared window for every rate instead of one sleep per collector
+        Sampler sampler;
+        sampler.tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        return to_json(sampler.tick());
+    }
+
+    std::string default_filename(const char *ext)
     {
         // buzz-snapshot-YYYYMMDD-HHMMSSZ.json
         auto now = std::chrono::system_clock::now();
@@ -105,7 +280,7 @@ namespace snapshot
         char buf[32];
         std::strftime(buf, sizeof(buf), "%Y%m%d-%H%M%SZ", &tm);
         std::ostringstream oss;
-        oss << "buzz-snapshot-" << buf << ".json";
+        oss << "buzz-snapshot-" << buf << ext;
         return oss.str();
     }
 
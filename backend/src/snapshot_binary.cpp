@@ -0,0 +1,547 @@
+#include "snapshot_binary.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <snapshot.hpp>
+
+using json = nlohmann::json;
+
+namespace snapshot
+{
+    static_assert(sizeof(Header) == 32 && sizeof(ColumnEntry) == 24 && sizeof(StringRef) == 8, "packed layout");
+    static_assert(sizeof(SystemRecord) % 8 == 0, "records keep the next column aligned");
+    // the process columns are written straight from ProcessTable's vectors
+    static_assert(sizeof(int) == 4 && sizeof(long) == 8, "LP64 only");
+
+    static constexpr std::uint32_t NO_STRING = std::numeric_limits<std::uint32_t>::max();
+
+    static std::size_t align8(std::size_t n) { return (n + 7) & ~std::size_t(7); }
+
+    // ---- writer ----
+
+    std::uint32_t BinaryImage::intern(std::string_view str)
+    {
+        auto it = string_ids_.find(str);
+        if (it != string_ids_.end())
+            return it->second;
+        std::uint32_t id = static_cast<std::uint32_t>(refs_.size());
+        refs_.push_back({static_cast<std::uint32_t>(strings_.size()), static_cast<std::uint32_t>(str.size())});
+        strings_.append(str);
+        string_ids_.emplace(str, id);
+        return id;
+    }
+
+    template <class T>
+    void BinaryImage::column(ColumnId id, const T *data, std::size_t count)
+    {
+        entries_.push_back({static_cast<std::uint32_t>(id), sizeof(T), count, 0});
+        data_.push_back(data);
+    }
+
+    template <class T>
+    T *BinaryImage::alloc(ColumnId id, std::size_t count)
+    {
+        if (owned_used_ == owned_.size())
+            owned_.emplace_back();
+        std::vector<char> &buf = owned_[owned_used_++];
+        buf.resize(count * sizeof(T));
+        T *data = reinterpret_cast<T *>(buf.data());
+        column(id, data, count);
+        return data;
+    }
+
+    void BinaryImage::encode(const SystemSample &s)
+    {
+        entries_.clear();
+        data_.clear();
+        owned_used_ = 0;
+        strings_.clear();
+        refs_.clear();
+        string_ids_.clear();
+
+        system_ = SystemRecord{};
+        system_.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(s.timestamp.time_since_epoch()).count();
+        system_.interval_s = s.interval_s;
+        system_.cpu_usage = s.cpu_usage;
+        system_.cpu_frequency = s.cpu_frequency;
+        system_.running_processes = s.running_processes;
+        system_.memory_usage = s.memory_usage;
+        system_.logical_processors = s.logical_processors;
+        system_.cpu_name = intern(s.cpu_name);
+        system_.battery_status = intern(s.battery.status);
+        system_.battery_charge = s.battery.current_charge;
+        if (s.topology)
+        {
+            system_.has_topology = 1;
+            system_.physical_cores = s.topology->physical_cores;
+            system_.sockets = s.topology->sockets;
+            system_.numa_nodes = s.topology->numa_nodes;
+            system_.threads_per_core = s.topology->threads_per_core;
+        }
+        column(ColumnId::System, &system_, 1);
+
+        column(ColumnId::CoreUsage, s.per_core_usage.data(), s.per_core_usage.size());
+        column(ColumnId::CoreFrequency, s.per_core_frequency.data(), s.per_core_frequency.size());
+        if (s.topology)
+        {
+            const auto &caches = s.topology->caches;
+            std::int32_t *level = alloc<std::int32_t>(ColumnId::CacheLevel, caches.size());
+            std::uint32_t *type = alloc<std::uint32_t>(ColumnId::CacheType, caches.size());
+            std::int64_t *size = alloc<std::int64_t>(ColumnId::CacheSizeKb, caches.size());
+            for (size_t i = 0; i < caches.size(); ++i)
+            {
+                level[i] = caches[i].level;
+                type[i] = intern(caches[i].type);
+                size[i] = caches[i].size_kb;
+            }
+        }
+
+        std::int64_t *mem = alloc<std::int64_t>(ColumnId::MemInfo, MEMINFO_FIELD_COUNT);
+        for (size_t i = 0; i < MEMINFO_FIELD_COUNT; ++i)
+            mem[i] = s.memory.*MEMINFO_FIELDS[i].member;
+
+        // processes: the numeric columns go out as they are; names and users are
+        // interned ids of this process, so they are mapped to the file's string table
+        const ProcessTable &t = s.process_table();
+        size_t n = t.size();
+        column(ColumnId::ProcPid, t.pid.data(), n);
+        column(ColumnId::ProcCpuUsage, t.cpu_usage.data(), n);
+        column(ColumnId::ProcCpuTime, t.cpu_time.data(), n);
+        column(ColumnId::ProcMemoryKb, t.memory_kb.data(), n);
+        column(ColumnId::ProcMemoryPercent, t.memory_percent.data(), n);
+        column(ColumnId::ProcThreads, t.threads.data(), n);
+        column(ColumnId::ProcState, t.state.data(), n);
+
+        auto remap = [this](std::vector<std::uint32_t> &ids, std::uint32_t id, const std::string &(*lookup)(std::uint32_t))
+        {
+            if (id >= ids.size())
+                ids.resize(id + 1, NO_STRING);
+            if (ids[id] == NO_STRING)
+                ids[id] = intern(lookup(id));
+            return ids[id];
+        };
+        name_ids_.clear();
+        user_ids_.clear();
+        std::uint32_t *name = alloc<std::uint32_t>(ColumnId::ProcName, n);
+        std::uint32_t *user = alloc<std::uint32_t>(ColumnId::ProcUser, n);
+        std::uint32_t *type = alloc<std::uint32_t>(ColumnId::ProcType, n);
+        std::uint32_t *status = alloc<std::uint32_t>(ColumnId::ProcStatus, n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            name[i] = remap(name_ids_, t.name[i], [](std::uint32_t id) -> const std::string &
+                            { return process_names().name(id); });
+            user[i] = remap(user_ids_, t.user[i], [](std::uint32_t id) -> const std::string &
+                            { return user_cache().name(id); });
+            type[i] = intern(s.processes()[i].type);
+            status[i] = intern(s.processes()[i].status);
+        }
+
+        size_t nd = s.disks.size();
+        std::uint32_t *device = alloc<std::uint32_t>(ColumnId::DiskDevice, nd);
+        std::int64_t *reads = alloc<std::int64_t>(ColumnId::DiskReads, nd);
+        std::int64_t *writes = alloc<std::int64_t>(ColumnId::DiskWrites, nd);
+        std::int64_t *sectors_read = alloc<std::int64_t>(ColumnId::DiskSectorsRead, nd);
+        std::int64_t *sectors_written = alloc<std::int64_t>(ColumnId::DiskSectorsWritten, nd);
+        double *read_ms = alloc<double>(ColumnId::DiskReadMs, nd);
+        double *write_ms = alloc<double>(ColumnId::DiskWriteMs, nd);
+        double *read_rate = alloc<double>(ColumnId::DiskReadRate, nd);
+        double *write_rate = alloc<double>(ColumnId::DiskWriteRate, nd);
+        for (size_t i = 0; i < nd; ++i)
+        {
+            const DiskStats &d = s.disks[i];
+            device[i] = intern(d.device);
+            reads[i] = d.reads_completed;
+            writes[i] = d.writes_completed;
+            sectors_read[i] = d.sectors_read;
+            sectors_written[i] = d.sectors_written;
+            read_ms[i] = d.read_time_ms;
+            write_ms[i] = d.write_time_ms;
+            read_rate[i] = d.read_rate;
+            write_rate[i] = d.write_rate;
+        }
+
+        size_t nn = s.network.size();
+        std::uint32_t *iface = alloc<std::uint32_t>(ColumnId::NetInterface, nn);
+        double *up = alloc<double>(ColumnId::NetUpload, nn);
+        double *down = alloc<double>(ColumnId::NetDownload, nn);
+        for (size_t i = 0; i < nn; ++i)
+        {
+            iface[i] = intern(s.network[i].interface);
+            up[i] = s.network[i].upload_rate;
+            down[i] = s.network[i].download_rate;
+        }
+
+        // last: nothing is interned after this
+        column(ColumnId::StringRefs, refs_.data(), refs_.size());
+        column(ColumnId::StringData, strings_.data(), strings_.size());
+
+        // lay the columns out after the directory and gather them
+        static const char zeros[8] = {};
+        size_t offset = align8(sizeof(Header) + entries_.size() * sizeof(ColumnEntry));
+        iov_.clear();
+        iov_.push_back({&header_, sizeof(Header)});
+        iov_.push_back({entries_.data(), entries_.size() * sizeof(ColumnEntry)});
+        if (size_t pad = offset - sizeof(Header) - entries_.size() * sizeof(ColumnEntry))
+            iov_.push_back({const_cast<char *>(zeros), pad});
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            ColumnEntry &e = entries_[i];
+            size_t bytes = e.elem_size * e.count;
+            e.offset = offset;
+            if (bytes == 0)
+                continue;
+            iov_.push_back({const_cast<void *>(data_[i]), bytes});
+            if (size_t pad = align8(bytes) - bytes)
+                iov_.push_back({const_cast<char *>(zeros), pad});
+            offset += align8(bytes);
+        }
+        size_ = offset;
+
+        std::memcpy(header_.magic, BINARY_MAGIC, sizeof(header_.magic));
+        header_.version = BINARY_VERSION;
+        header_.endian = BINARY_ENDIAN;
+        header_.file_size = size_;
+        header_.column_count = static_cast<std::uint32_t>(entries_.size());
+        header_.header_size = sizeof(Header);
+    }
+
+    void BinaryImage::copy_to(void *dst) const
+    {
+        char *out = static_cast<char *>(dst);
+        for (const iovec &v : iov_)
+        {
+            std::memcpy(out, v.iov_base, v.iov_len);
+            out += v.iov_len;
+        }
+    }
+
+    bool save_binary(const SystemSample &s, const std::string &path, std::string *err)
+    {
+        BinaryImage img;
+        img.encode(s);
+
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            if (err)
+                *err = "Failed to open file for writing: " + path + ": " + std::strerror(errno);
+            return false;
+        }
+
+        // one writev for the whole file; only a short write (signal, full disk) loops
+        std::vector<iovec> iov = img.iov();
+        size_t first = 0;
+        bool ok = true;
+        while (first < iov.size())
+        {
+            ssize_t n = ::writev(fd, iov.data() + first, static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX)));
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                ok = false;
+                break;
+            }
+            size_t left = static_cast<size_t>(n);
+            while (first < iov.size() && left >= iov[first].iov_len)
+                left -= iov[first++].iov_len;
+            if (left > 0)
+            {
+                iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + left;
+                iov[first].iov_len -= left;
+            }
+        }
+        if (!ok && err)
+            *err = "Failed writing snapshot to: " + path + ": " + std::strerror(errno);
+        if (::close(fd) != 0 && ok)
+        {
+            ok = false;
+            if (err)
+                *err = "Failed writing snapshot to: " + path + ": " + std::strerror(errno);
+        }
+        return ok;
+    }
+
+    // ---- reader ----
+
+    BinarySnapshot::~BinarySnapshot()
+    {
+        unmap();
+    }
+
+    void BinarySnapshot::unmap()
+    {
+        if (map_)
+            ::munmap(map_, size_);
+        map_ = nullptr;
+        base_ = nullptr;
+        size_ = 0;
+    }
+
+    bool BinarySnapshot::open(const std::string &path, std::string *err)
+    {
+        unmap();
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            if (err)
+                *err = path + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+        {
+            if (err)
+                *err = path + ": not a binary snapshot";
+            ::close(fd);
+            return false;
+        }
+        void *map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+        {
+            if (err)
+                *err = path + ": mmap: " + std::strerror(errno);
+            return false;
+        }
+
+        if (!attach(map, static_cast<size_t>(st.st_size), err))
+        {
+            ::munmap(map, static_cast<size_t>(st.st_size));
+            return false;
+        }
+        map_ = map;
+        return true;
+    }
+
+    bool BinarySnapshot::attach(const void *data, std::size_t size, std::string *err)
+    {
+        unmap();
+        auto fail = [&](const char *why)
+        {
+            if (err)
+                *err = why;
+            std::fill(std::begin(entries_), std::end(entries_), nullptr);
+            system_ = nullptr;
+            return false;
+        };
+
+        const char *base = static_cast<const char *>(data);
+        if (size < sizeof(Header) || reinterpret_cast<std::uintptr_t>(base) % 8 != 0)
+            return fail("not a binary snapshot");
+        const Header *h = reinterpret_cast<const Header *>(base);
+        if (std::memcmp(h->magic, BINARY_MAGIC, sizeof(h->magic)) != 0)
+            return fail("not a binary snapshot");
+        if (h->endian != BINARY_ENDIAN)
+            return fail("binary snapshot written with the other byte order");
+        if (h->version != BINARY_VERSION)
+            return fail("unsupported binary snapshot version");
+        // the directory starts at header_size: it has to lie inside the file and keep
+        // the entries aligned before column_count can be bounded by what follows it
+        if (h->file_size > size)
+            return fail("truncated binary snapshot");
+        if (h->header_size < sizeof(Header) || h->header_size > h->file_size || h->header_size % 8 != 0)
+            return fail("corrupt binary snapshot header");
+        if (h->column_count > (h->file_size - h->header_size) / sizeof(ColumnEntry))
+            return fail("truncated binary snapshot");
+
+        // every column has to lie inside the file, aligned for its type
+        std::fill(std::begin(entries_), std::end(entries_), nullptr);
+        const ColumnEntry *dir = reinterpret_cast<const ColumnEntry *>(base + h->header_size);
+        for (std::uint32_t i = 0; i < h->column_count; ++i)
+        {
+            const ColumnEntry &e = dir[i];
+            if (e.elem_size == 0 || e.offset % 8 != 0 || e.offset > h->file_size ||
+                e.count > (h->file_size - e.offset) / e.elem_size)
+                return fail("corrupt binary snapshot column");
+            if (e.id < static_cast<std::uint32_t>(ColumnId::Max))
+                entries_[e.id] = &e; // unknown ids are skipped
+        }
+
+        base_ = base;
+        size_ = static_cast<size_t>(h->file_size);
+        Span<SystemRecord> sys = column<SystemRecord>(ColumnId::System);
+        if (sys.size != 1)
+        {
+            base_ = nullptr;
+            return fail("binary snapshot has no system record");
+        }
+        system_ = sys.data;
+        refs_ = column<StringRef>(ColumnId::StringRefs);
+        chars_ = column<char>(ColumnId::StringData);
+        return true;
+    }
+
+    std::string_view BinarySnapshot::string(std::uint32_t index) const
+    {
+        if (index >= refs_.size)
+            return {};
+        const StringRef &r = refs_[index];
+        if (r.offset > chars_.size || r.size > chars_.size - r.offset)
+            return {};
+        return {chars_.data + r.offset, r.size};
+    }
+
+    // ---- conversions ----
+
+    bool to_sample(const BinarySnapshot &b, SystemSample &s, std::string *err)
+    {
+        const SystemRecord &sys = b.system();
+        SystemSample out;
+        out.timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(sys.timestamp_ns)));
+        out.interval_s = sys.interval_s;
+        out.cpu_usage = sys.cpu_usage;
+        out.cpu_frequency = sys.cpu_frequency;
+        out.running_processes = sys.running_processes;
+        out.memory_usage = sys.memory_usage;
+        out.logical_processors = sys.logical_processors;
+        out.cpu_name = b.string(sys.cpu_name);
+        out.battery.status = b.string(sys.battery_status);
+        out.battery.current_charge = sys.battery_charge;
+
+        auto usage = b.column<double>(ColumnId::CoreUsage);
+        auto freq = b.column<double>(ColumnId::CoreFrequency);
+        out.per_core_usage.assign(usage.begin(), usage.end());
+        out.per_core_frequency.assign(freq.begin(), freq.end());
+
+        if (sys.has_topology)
+        {
+            auto topo = std::make_shared<CpuTopology>();
+            topo->model_name = out.cpu_name;
+            topo->logical_cpus = out.logical_processors;
+            topo->physical_cores = sys.physical_cores;
+            topo->sockets = sys.sockets;
+            topo->numa_nodes = sys.numa_nodes;
+            topo->threads_per_core = sys.threads_per_core;
+            auto level = b.column<std::int32_t>(ColumnId::CacheLevel);
+            auto type = b.column<std::uint32_t>(ColumnId::CacheType);
+            auto size = b.column<std::int64_t>(ColumnId::CacheSizeKb);
+            for (size_t i = 0; i < level.size && i < type.size && i < size.size; ++i)
+                topo->caches.push_back({level[i], std::string(b.string(type[i])), size[i]});
+            out.topology = std::move(topo);
+        }
+
+        auto mem = b.column<std::int64_t>(ColumnId::MemInfo);
+        for (size_t i = 0; i < mem.size && i < MEMINFO_FIELD_COUNT; ++i)
+            out.memory.*MEMINFO_FIELDS[i].member = mem[i];
+
+        auto pid = b.column<std::int32_t>(ColumnId::ProcPid);
+        auto cpu_usage = b.column<double>(ColumnId::ProcCpuUsage);
+        auto cpu_time = b.column<double>(ColumnId::ProcCpuTime);
+        auto memory_kb = b.column<std::int64_t>(ColumnId::ProcMemoryKb);
+        auto memory_percent = b.column<double>(ColumnId::ProcMemoryPercent);
+        auto threads = b.column<std::int32_t>(ColumnId::ProcThreads);
+        auto state = b.column<char>(ColumnId::ProcState);
+        auto name = b.column<std::uint32_t>(ColumnId::ProcName);
+        auto user = b.column<std::uint32_t>(ColumnId::ProcUser);
+        auto type = b.column<std::uint32_t>(ColumnId::ProcType);
+        auto status = b.column<std::uint32_t>(ColumnId::ProcStatus);
+        size_t n = pid.size;
+        for (size_t c : {cpu_usage.size, cpu_time.size, memory_kb.size, memory_percent.size, threads.size,
+                         state.size, name.size, user.size, type.size, status.size})
+            if (c != n)
+            {
+                if (err)
+                    *err = "binary snapshot process columns differ in length";
+                return false;
+            }
+
+        // users repeat a lot; intern each distinct one once
+        std::vector<UserId> users(b.column<StringRef>(ColumnId::StringRefs).size, static_cast<UserId>(NO_STRING));
+        std::vector<ProcessInfo> processes(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            ProcessInfo &p = processes[i];
+            p.pid = pid[i];
+            p.process_name = b.string(name[i]);
+            p.type = b.string(type[i]);
+            p.cpu.cpu_usage = cpu_usage[i];
+            p.cpu.cpu_time = cpu_time[i];
+            p.memory_usage = memory_kb[i];
+            p.memory_percent = memory_percent[i];
+            p.status = b.string(status[i]);
+            p.state = state[i];
+            p.threads = threads[i];
+            if (user[i] < users.size() && users[user[i]] == static_cast<UserId>(NO_STRING))
+                users[user[i]] = user_cache().intern(std::string(b.string(user[i])));
+            p.user = user[i] < users.size() ? users[user[i]] : UNKNOWN_USER;
+        }
+        out.set_processes(std::move(processes));
+
+        auto device = b.column<std::uint32_t>(ColumnId::DiskDevice);
+        auto reads = b.column<std::int64_t>(ColumnId::DiskReads);
+        auto writes = b.column<std::int64_t>(ColumnId::DiskWrites);
+        auto sectors_read = b.column<std::int64_t>(ColumnId::DiskSectorsRead);
+        auto sectors_written = b.column<std::int64_t>(ColumnId::DiskSectorsWritten);
+        auto read_ms = b.column<double>(ColumnId::DiskReadMs);
+        auto write_ms = b.column<double>(ColumnId::DiskWriteMs);
+        auto read_rate = b.column<double>(ColumnId::DiskReadRate);
+        auto write_rate = b.column<double>(ColumnId::DiskWriteRate);
+        for (size_t c : {reads.size, writes.size, sectors_read.size, sectors_written.size, read_ms.size, write_ms.size,
+                         read_rate.size, write_rate.size})
+            if (c != device.size)
+            {
+                if (err)
+                    *err = "binary snapshot disk columns differ in length";
+                return false;
+            }
+        for (size_t i = 0; i < device.size; ++i)
+            out.disks.push_back({std::string(b.string(device[i])), reads[i], writes[i], sectors_read[i],
+                                 sectors_written[i], read_ms[i], write_ms[i], read_rate[i], write_rate[i]});
+
+        auto iface = b.column<std::uint32_t>(ColumnId::NetInterface);
+        auto up = b.column<double>(ColumnId::NetUpload);
+        auto down = b.column<double>(ColumnId::NetDownload);
+        if (up.size != iface.size || down.size != iface.size)
+        {
+            if (err)
+                *err = "binary snapshot network columns differ in length";
+            return false;
+        }
+        for (size_t i = 0; i < iface.size; ++i)
+            out.network.push_back({std::string(b.string(iface[i])), up[i], down[i]});
+
+        s = std::move(out);
+        return true;
+    }
+
+    bool convert_file(const std::string &in, const std::string &out, std::string *err)
+    {
+        SystemSample s;
+        BinarySnapshot b;
+        std::string bin_err;
+        if (b.open(in, &bin_err))
+        {
+            if (!to_sample(b, s, err))
+                return false;
+            return save_to_file(to_json(s), out, err);
+        }
+
+        // not binary: expect the JSON snapshot layout
+        std::ifstream ifs(in);
+        if (!ifs.is_open())
+        {
+            if (err)
+                *err = "Failed to open file for reading: " + in;
+            return false;
+        }
+        json j = json::parse(ifs, nullptr, false);
+        if (j.is_discarded())
+        {
+            if (err)
+                *err = in + ": neither a binary nor a JSON snapshot (" + bin_err + ")";
+            return false;
+        }
+        return from_json(j, s, err) && save_binary(s, out, err);
+    }
+}
@@ -0,0 +1,79 @@
+#include "stream.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sampler_thread.hpp>
+
+// write all of buf, retrying short writes; false with errno set on failure
+static bool write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, buf, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+int stream::run(const StreamOptions &opts)
+{
+    // a FIFO blocks here until a reader opens it; signals still work at this point
+    int out = STDOUT_FILENO;
+    bool own_fd = !opts.path.empty() && opts.path != "-";
+    if (own_fd)
+    {
+        out = ::open(opts.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (out < 0)
+        {
+            std::cerr << "buzz: " << opts.path << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+    }
+
+    // a closed pipe shows up as EPIPE from write() and ends the stream quietly
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // collectors for sections nobody asked for would only cost time, and
+    // sections whose collector is off would only repeat zeros
+    CollectorConfig collectors = opts.collectors;
+    disable_unused_collectors(opts.sections, collectors);
+    unsigned sections = opts.sections & collected_sections(collectors);
+
+    bool ok = true;
+    std::string line; // reused across ticks
+    std::string err;
+    auto write_sample = [&](const SystemSample &sample)
+    {
+        // if the reader lags, intermediate samples are skipped, never split
+        line = snapshot::to_json(sample, sections).dump();
+        line += '\n';
+        if (write_all(out, line.data(), line.size()))
+            return true;
+        if (errno != EPIPE)
+        {
+            err = std::string("stream write: ") + std::strerror(errno);
+            ok = false;
+        }
+        return false;
+    };
+    if (!run_until_signal(opts.collector_threads, opts.process_backend, opts.interval, collectors, write_sample, &err))
+        ok = false;
+    if (!ok)
+        std::cerr << "buzz: " << err << "\n";
+
+    if (own_fd)
+        ::close(out);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include "terminal.hpp"
+
+RawTerminal::RawTerminal(int fd) : fd_(fd)
+{
+    if (!::isatty(fd_) || ::tcgetattr(fd_, &saved_) != 0)
+        return;
+
+    termios raw = saved_;
+    raw.c_lflag &= ~static_cast<tcflag_t>(ICANON | ECHO);
+    raw.c_iflag &= ~static_cast<tcflag_t>(IXON | ICRNL);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    active_ = ::tcsetattr(fd_, TCSAFLUSH, &raw) == 0;
+}
+
+RawTerminal::~RawTerminal()
+{
+    if (active_)
+        ::tcsetattr(fd_, TCSAFLUSH, &saved_);
+}
+
+// the key an escape sequence stands for, or None while it is still incomplete;
+// len receives the bytes it spans
+static Key::Code decode_escape(const std::string &s, size_t pos, size_t &len)
+{
+    // s[pos] == '\033'
+    if (pos + 1 >= s.size())
+        return Key::None;
+
+    char intro = s[pos + 1];
+    if (intro != '[' && intro != 'O')
+    {
+        // ESC followed by an ordinary key (Alt+key): report the Escape alone
+        len = 1;
+        return Key::Escape;
+    }
+
+    // CSI / SS3: parameters (digits, ';') then one final byte
+    size_t i = pos + 2;
+    while (i < s.size() && ((s[i] >= '0' && s[i] <= '9') || s[i] == ';'))
+        ++i;
+    if (i >= s.size())
+        return Key::None;
+
+    len = i - pos + 1;
+    std::string params = s.substr(pos + 2, i - pos - 2);
+    switch (s[i])
+    {
+    case 'A':
+        return Key::Up;
+    case 'B':
+        return Key::Down;
+    case 'C':
+        return Key::Right;
+    case 'D':
+        return Key::Left;
+    case 'H':
+        return Key::Home;
+    case 'F':
+        return Key::End;
+    case '~':
+        if (params == "5")
+            return Key::PageUp;
+        if (params == "6")
+            return Key::PageDown;
+        if (params == "1" || params == "7")
+            return Key::Home;
+        if (params == "4" || params == "8")
+            return Key::End;
+        if (params == "3")
+            return Key::Delete;
+        break;
+    default:
+        break;
+    }
+    // well-formed but not a key we use (function keys, mouse, ...)
+    return Key::Char;
+}
+
+void KeyDecoder::feed(const char *data, size_t n, std::vector<Key> &out)
+{
+    pending_.append(data, n);
+
+    size_t pos = 0;
+    while (pos < pending_.size())
+    {
+        unsigned char c = static_cast<unsigned char>(pending_[pos]);
+        if (c == '\033')
+        {
+            size_t len = 0;
+            Key::Code code = decode_escape(pending_, pos, len);
+            if (code == Key::None)
+            {
+                if (pos + 1 == pending_.size())
+                {
+                    // lone ESC
+                    out.push_back({Key::Escape, 0});
+                    ++pos;
+                }
+                break; // incomplete sequence: wait for the rest
+            }
+            if (code != Key::Char)
+                out.push_back({code, 0});
+            pos += len;
+            continue;
+        }
+
+        if (c == '\r' || c == '\n')
+            out.push_back({Key::Enter, 0});
+        else if (c == 0x7f || c == '\b')
+            out.push_back({Key::Backspace, 0});
+        else if (c == '\t')
+            out.push_back({Key::Tab, 0});
+        else if (c >= 0x20 && c < 0x7f)
+            out.push_back({Key::Char, static_cast<char>(c)});
+        ++pos;
+    }
+    pending_.erase(0, pos);
+}
@@ -1,706 +1,1146 @@
 #include <iostream>
 #include <string>
-#include <set>
 #include <vector>
 #include <csignal>
-#include <thread>
 #include <chrono>
-#include <map>
+#include <memory>
 #include <algorithm>
-#include <iomanip>
 #include <sstream>
-#include <cctype>
+#include <cstdio>
 #include <cstdlib>
-#include <sys/select.h>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/signalfd.h>
 #include <unistd.h>
-#include <sys/ioctl.h>
 #include <filesystem>
-
-#include <nlohmann/json.hpp>
+#include <iomanip>
 
 #include <cpu.hpp>
 #include <memory.hpp>
 #include <processes.hpp>
+#include <process_table.hpp>
 #include <disk.hpp>
 #include <network.hpp>
 #include <battery.hpp>
+#include <collector.hpp>
+#include <history.hpp>
+#include <layout.hpp>
+#include <render.hpp>
+#include <replay.hpp>
+#include <screen.hpp>
+#include <sampler.hpp>
+#include <sampler_thread.hpp>
 #include <snapshot.hpp>
+#include <snapshot_binary.hpp>
+#include <stream.hpp>
+#include <terminal.hpp>
 
-using json = nlohmann::json;
-
-// signal handling
-static bool running = true;
-
-static void on_signal(int)
-{
-    running = false;
-}
-
-// colors
 namespace ansi
 {
-    // clear entire screen + scrollback and move cursor home
-    static const char *clear = "\033[H\033[2J\033[3J";
-    static const char *home = "\033[H";
+    // wipe scrollback once on startup; frames themselves are diffed by Screen
+    static const char *clear_scrollback = "\033[3J";
     static const char *hide_cursor = "\033[?25l";
     static const char *show_cursor = "\033[?25h";
-
-    struct Theme
-    {
-        std::string reset = "\033[0m";
-        std::string dim = "\033[2m";
-        std::string header = "\033[1;36m"; // cyan
-        std::string title = "\033[1;35m";  // magenta
-        std::string ok = "\033[1;32m";     // green
-        std::string warn = "\033[1;33m";   // yellow
-        std::string err = "\033[1;31m";    // red
-        bool enabled = true;
-
-        std::string on(bool enabled, const std::string &code)
-        {
-            return enabled ? code : "";
-        }
-    };
-
+    static const char *reset = "\033[0m";
 }
-static ansi::Theme theme;
 
 // config options
 struct Options
 {
     int refresh_ms = 2000;
     bool no_color = false;
-    std::string sort = "cpu"; // options being cpu or mem
+    std::string sort = "cpu"; // comma-separated keys, see parse_process_order
+    std::vector<ProcessSortKey> sort_keys{ProcessSortKey::Cpu};
     int top = 25;
+    int collector_threads = 1; // threads scanning /proc/<pid>
+    ProcessBackend process_backend = ProcessBackend::Proc;
+    CollectorConfig collectors; // --collect: collectors off or on their own interval
+
+    // --stream: NDJSON on stdout or a file instead of the TUI
+    bool stream = false;
+    std::string stream_path;
+    unsigned fields = snapshot::All;
+
+    // --convert: binary <-> JSON snapshot, then exit
+    std::string convert_in, convert_out;
+
+    // --record: history ring in a directory instead of the TUI
+    std::string record_dir;
+    size_t record_bytes = history::DEFAULT_RING_BYTES;
+    std::string record_info; // --record-info: summarize a recording and exit
+
+    // --replay: play a recording through the TUI instead of sampling
+    std::string replay_path;
 };
 
-// flatten json from main.cpp
-static void flatten_json(const json &j, const std::string &prefix, std::map<std::string, std::string> &out)
+// interactive state changed by keys between collections
+struct UiState
 {
-    if (j.is_object())
+    std::string status; // result of the last command, shown above the prompt
+    Screen::Style status_style = Screen::Normal;
+
+    // line being typed at the bottom row, and what Enter does with it
+    enum class Prompt
     {
-        for (auto it = j.begin(); it != j.end(); ++it)
-        {
-            std::string key = prefix.empty() ? it.key() : (prefix + "." + it.key());
-            flatten_json(it.value(), key, out);
-        }
+        None,
+        Kill,   // <pid> [--sigkill|--sigterm|--signal <num>]
+        Pid,    // scroll to a pid
+        Search, // filter by name
+        Seek,   // replay: jump to a time
+    };
+    Prompt prompt = Prompt::None;
+    std::string input;
+
+    // process list viewport: only its rows are ranked in full and formatted
+    size_t scroll = 0;     // position of the first row shown
+    std::string filter;    // name substring, empty for all
+    int selected_pid = 0;  // highlighted after a jump, 0 for none
+    size_t page = 25;      // viewport height of the last frame
+};
+
+using render::fmt_pct;
+using render::human_bytes;
+using render::human_bytes_total;
+
+// print a thin gray line for dividing tables
+static void print_line(Screen &scr)
+{
+    // leave a tiny margin
+    scr.fill('-', std::max(20, scr.cols() - 2), Screen::Dim);
+    scr.print("\n");
+}
+
+// clean formatting of key-value pairs
+static void print_kv(Screen &scr, const std::vector<std::pair<std::string, std::string>> &rows)
+{
+    size_t kmax = 0;
+    for (auto &kv : rows)
+        kmax = std::max(kmax, kv.first.size());
+    for (auto &kv : rows)
+    {
+        scr.print("  ");
+        scr.print(kv.first, Screen::Header);
+        scr.fill(' ', static_cast<int>(kmax - kv.first.size()));
+        scr.print(" : ");
+        scr.print(kv.second);
+        scr.print("\n");
     }
-    else if (j.is_array())
+}
+
+// text left-aligned in width columns (ellipsized if longer), then gap spaces
+static void print_cell(Screen &scr, std::string_view text, size_t width, int gap, Screen::Style style = Screen::Normal)
+{
+    if (text.size() > width)
     {
-        if (j.empty())
-        {
-            out[prefix] = "[]";
-        }
+        if (width <= 3)
+            text = text.substr(0, width);
         else
         {
-            // expand array w indices
-            // eg: network.interfaces[0].interface = "lo
-            for (size_t i = 0; i < j.size(); ++i)
-            {
-                std::string key = prefix + "[" + std::to_string(i) + "]";
-                flatten_json(j[i], key, out);
-            }
+            scr.print(text.substr(0, width - 3), style);
+            scr.print("...", style);
+            text = {};
+            width = 0;
         }
     }
-    else if (j.is_string())
+    scr.print(text, style);
+    scr.fill(' ', static_cast<int>(width - std::min(width, text.size())) + gap, style);
+}
+
+// widths come from the layout (fixed per terminal size), so only the cells that are
+// drawn, rows [0, max_rows) of the columns that fit, are ever formatted
+static void print_table(Screen &scr, const render::Table &table, const std::vector<size_t> &widths, size_t max_rows)
+{
+    scr.print(table.title, Screen::Title);
+    scr.print("\n");
+    if (table.rows == 0)
     {
-        out[prefix] = j.get<std::string>();
+        scr.print("  (no data)\n");
+        return;
     }
-    else if (j.is_number_integer())
+    const std::vector<render::Column> &columns = *table.columns;
+
+    // header is left-aligned, in cyan, 2 spaces per column
+    size_t last = widths.size(); // last shown column, which gets no trailing gap
+    while (last > 0 && widths[last - 1] == 0)
+        --last;
+
+    scr.print("  ");
+    for (size_t i = 0; i < last; ++i)
+        if (widths[i])
+            print_cell(scr, columns[i].title, widths[i], i + 1 < last ? 2 : 0, Screen::Header);
+    scr.print("\n");
+    print_line(scr);
+
+    // prints upto max rows for data rows
+    // left aligned
+    static std::string cell; // reused across cells and frames
+    size_t rcount = std::min(table.rows, max_rows);
+    for (size_t r = 0; r < rcount; ++r)
     {
-        out[prefix] = std::to_string(j.get<long long>());
+        // the selected row is marked in the margin too, so it shows without color
+        bool selected = (r == table.highlight);
+        scr.print(selected ? "> " : "  ");
+        for (size_t i = 0; i < last; ++i)
+        {
+            if (!widths[i])
+                continue; // hidden: not even formatted
+            cell.clear();
+            table.cell(r, i, cell);
+            print_cell(scr, cell, widths[i], i + 1 < last ? 2 : 0, selected ? Screen::Selected : Screen::Normal);
+        }
+        scr.print("\n");
     }
-    else if (j.is_number_unsigned())
+}
+
+static const char *sort_key_label(ProcessSortKey key)
+{
+    switch (key)
     {
-        out[prefix] = std::to_string(j.get<unsigned long long>());
+    case ProcessSortKey::Cpu:
+        return "CPU%";
+    case ProcessSortKey::Memory:
+        return "Memory%";
+    case ProcessSortKey::Threads:
+        return "Threads";
+    case ProcessSortKey::CpuTime:
+        return "CPU Time";
+    case ProcessSortKey::Pid:
+        return "PID";
+    case ProcessSortKey::Name:
+        return "Name";
     }
-    else if (j.is_number_float())
+    return "";
+}
+
+// top processes, with the columns of the primary sort key moved forward so they
+// are the last to be trimmed on narrow terminals
+static render::Table process_table(const SystemSample &sample, const std::vector<std::uint32_t> &order, size_t total,
+                                   const Options &opts, const UiState &ui)
+{
+    enum Col
     {
-        std::ostringstream oss;
-        oss << std::fixed << std::setprecision(2) << j.get<double>();
-        out[prefix] = oss.str();
-    }
-    else if (j.is_boolean())
+        Pid,
+        Name,
+        User,
+        Status,
+        Threads,
+        Type,
+        CpuPct,
+        CpuTime,
+        MemPct,
+        Rss,
+    };
+    static const render::Column specs[] = {
+        {"PID", 7}, {"Name", 16, 40}, {"User", 8, 12, 2}, {"Status", 8, 17, 3}, {"Threads", 7, 0, 4},
+        {"Type", 18, 0, 5}, {"CPU%", 6}, {"CPU Time", 9, 0, 1}, {"Mem%", 6}, {"RSS", 8, 0, 1}};
+    auto columns_of = [](const std::vector<Col> &cols)
     {
-        out[prefix] = j.get<bool>() ? "true" : "false";
-    }
-    else if (j.is_null())
+        std::vector<render::Column> c;
+        for (Col x : cols)
+            c.push_back(specs[x]);
+        return c;
+    };
+    static const std::vector<Col> cpu_first = {Pid, Name, User, Status, Threads, Type, CpuPct, CpuTime, MemPct, Rss};
+    static const std::vector<Col> mem_first = {Pid, Name, User, Status, Threads, Type, MemPct, Rss, CpuPct, CpuTime};
+    static const std::vector<render::Column> cpu_columns = columns_of(cpu_first);
+    static const std::vector<render::Column> mem_columns = columns_of(mem_first);
+
+    bool by_mem = opts.sort_keys.front() == ProcessSortKey::Memory;
+    const std::vector<Col> *cols = by_mem ? &mem_first : &cpu_first;
+
+    render::Table t;
+    t.title = "Processes (sorted by ";
+    for (size_t i = 0; i < opts.sort_keys.size(); ++i)
+        t.title += std::string(i ? ", " : "") + sort_key_label(opts.sort_keys[i]);
+    t.title += ", " + (order.empty() ? std::string("0") : std::to_string(ui.scroll + 1) + "-" + std::to_string(ui.scroll + order.size()));
+    t.title += " of " + std::to_string(total);
+    if (!ui.filter.empty())
+        t.title += ", matching '" + ui.filter + "'";
+    t.title += ")";
+    t.columns = by_mem ? &mem_columns : &cpu_columns;
+    t.rows = order.size();
+    for (size_t i = 0; i < order.size(); ++i)
+        if (ui.selected_pid != 0 && sample.process_table().pid[order[i]] == ui.selected_pid)
+            t.highlight = i;
+    t.cell = [&sample, &order, cols](size_t row, size_t col, std::string &out)
     {
-        out[prefix] = "null";
-    }
+        const ProcessInfo &p = sample.processes()[order[row]];
+        switch ((*cols)[col])
+        {
+        case Pid:
+            render::append_int(out, p.pid);
+            break;
+        case Name:
+            out += p.process_name;
+            break;
+        case User:
+            out += user_name(p);
+            break;
+        case Status:
+            out += p.status;
+            break;
+        case Threads:
+            render::append_int(out, p.threads);
+            break;
+        case Type:
+            out += p.type;
+            break;
+        case CpuPct:
+            render::append_fixed(out, p.cpu.cpu_usage, 2);
+            break;
+        case CpuTime:
+            render::append_fixed(out, p.cpu.cpu_time, 2);
+            break;
+        case MemPct:
+            render::append_fixed(out, p.memory_percent, 2);
+            break;
+        case Rss:
+            render::append_bytes(out, 1024.0 * p.memory_usage);
+            break;
+        }
+    };
+    return t;
 }
 
-// 4.2013 -> "4.2%"
-static std::string fmt_pct(double v)
+static render::Table core_table(const SystemSample &sample)
 {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(1) << v << "%";
-    return oss.str();
+    render::Table t;
+    t.title = "CPU Cores";
+    static const std::vector<render::Column> columns = {{"Core", 4}, {"Usage%", 6}, {"Freq (MHz)", 10}};
+    t.columns = &columns;
+    t.rows = sample.per_core_usage.size();
+    t.cell = [&sample](size_t row, size_t col, std::string &out)
+    {
+        if (col == 0)
+            render::append_int(out, static_cast<long long>(row));
+        else if (col == 1)
+            render::append_fixed(out, sample.per_core_usage[row], 2);
+        else if (row < sample.per_core_frequency.size())
+            render::append_fixed(out, sample.per_core_frequency[row], 2);
+    };
+    return t;
 }
 
-// bps to human-readable form w/ corresponding unit!
-// 1048576.0 -> "1.00 MB/s"
-static std::string human_bytes(double bps)
+static render::Table network_table(const SystemSample &sample)
 {
-    const char *units[] = {"B/s", "KB/s", "MB/s", "GB/s", "TB/s"};
-    int idx = 0;
-    while (bps >= 1024.0 && idx < 4)
+    render::Table t;
+    t.title = "Network Interfaces";
+    static const std::vector<render::Column> columns = {{"Interface", 10, 20}, {"Download", 10}, {"Upload", 10}};
+    t.columns = &columns;
+    t.rows = sample.network.size();
+    t.cell = [&sample](size_t row, size_t col, std::string &out)
     {
-        bps /= 1024.0;
-        ++idx;
-    }
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(bps >= 100 ? 0 : 1) << bps << " " << units[idx];
-    return oss.str();
+        const NetworkStats &n = sample.network[row];
+        if (col == 0)
+            out += n.interface;
+        else
+            render::append_rate(out, col == 1 ? n.download_rate : n.upload_rate);
+    };
+    return t;
 }
 
-// same but byte COUNTS
-// 8192.0 -> "8.0 KB"
-static std::string human_bytes_total(double bytes)
+static render::Table disk_table(const SystemSample &sample)
 {
-    const char *units[] = {"B", "KB", "MB", "GB", "TB"};
-    int idx = 0;
-    while (bytes >= 1024.0 && idx < 4)
+    render::Table t;
+    t.title = "Disks";
+    static const std::vector<render::Column> columns = {
+        {"Device", 8, 16}, {"Read", 10}, {"Write", 10}, {"Reads", 8, 0, 1}, {"Writes", 8, 0, 1},
+        {"Sectors Read", 12, 0, 3}, {"Sectors Written", 15, 0, 3}, {"Read ms", 10, 0, 2}, {"Write ms", 10, 0, 2}};
+    t.columns = &columns;
+    t.rows = sample.disks.size();
+    t.cell = [&sample](size_t row, size_t col, std::string &out)
     {
-        bytes /= 1024.0;
-        ++idx;
-    }
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(bytes >= 100 ? 0 : 1) << bytes << " " << units[idx];
-    return oss.str();
+        const DiskStats &d = sample.disks[row];
+        switch (col)
+        {
+        case 0:
+            out += d.device;
+            break;
+        case 1:
+            render::append_rate(out, d.read_rate);
+            break;
+        case 2:
+            render::append_rate(out, d.write_rate);
+            break;
+        case 3:
+            render::append_int(out, d.reads_completed);
+            break;
+        case 4:
+            render::append_int(out, d.writes_completed);
+            break;
+        case 5:
+            render::append_int(out, d.sectors_read);
+            break;
+        case 6:
+            render::append_int(out, d.sectors_written);
+            break;
+        case 7:
+            render::append_fixed(out, d.read_time_ms, 2);
+            break;
+        case 8:
+            render::append_fixed(out, d.write_time_ms, 2);
+            break;
+        }
+    };
+    return t;
 }
 
-// print a thin gray line for dividing tables
-static void print_line()
+static void usage(const char *argv0)
 {
-    // adapt to terminal width
-    winsize ws{};
-    int width = 120;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
-        width = ws.ws_col;
-    // leave a tiny margin
-    int line_len = std::max(20, width - 2);
-    std::cout << theme.on(theme.enabled, theme.dim) << std::string(line_len, '-') << theme.on(theme.enabled, theme.reset) << "\n";
+    std::cout << "Usage: " << argv0 << " [--refresh <ms>] [--no-color] [--sort cpu|mem|threads|time|pid|name[,...]] [--top N] [--collector-threads N] [--process-backend proc|netlink] [--collect ...]\n"
+              << "       " << argv0 << " --stream [path] [--fields cpu,cores,topology,memory,processes,disk,network,battery] [--refresh <ms>]\n"
+              << "       " << argv0 << " --convert <in> <out>   (binary snapshot <-> JSON, by the input's format)\n"
+              << "       " << argv0 << " --record <dir> [--record-size <MB>] [--refresh <ms>]\n"
+              << "       " << argv0 << " --record-info <dir>\n"
+              << "       " << argv0 << " --replay <record dir | snapshot dir | snapshot file> [TUI options]\n"
+              << "\n"
+              << "  --record scans processes every " << history::RECORD_PROCESS_INTERVAL.count() / 1000
+              << " s to stay under 1% of a core on a 5k-process host; --collect processes=<interval> overrides it\n"
+              << "  --stream --fields turns off the collectors none of the fields need, unless --collect names them\n"
+              << "  --collect <collector>=<ms|Ns|off|on>[,...]   run a collector on its own interval, or not at all;\n"
+              << "                                               intervals shorter than --refresh mean every tick\n";
+    for (const CollectorInfo &c : BUILTIN_COLLECTORS)
+    {
+        std::string interval = c.interval.count() ? std::to_string(c.interval.count()) + " ms" : "every tick";
+        std::cout << "      " << std::left << std::setw(11) << c.name << std::setw(10) << collector_cost_name(c.cost)
+                  << std::setw(12) << interval << c.reads << "\n";
+    }
 }
 
-// clean formatting of key-value pairs
-static void print_kv(const std::vector<std::pair<std::string, std::string>> &rows)
+static Options parse_opts(int argc, char **argv)
 {
-    size_t kmax = 0;
-    for (auto &kv : rows)
-        kmax = std::max(kmax, kv.first.size());
-    for (auto &kv : rows)
+    Options o; // initialize w default options
+    for (int i = 1; i < argc; ++i)
     {
-        std::cout << "  " << theme.on(theme.enabled, theme.header) << std::setw((int)kmax) << std::left << kv.first
-                  << theme.on(theme.enabled, theme.reset) << " : " << kv.second << "\n";
+        std::string a = argv[i];
+        if (a == "--refresh" && i + 1 < argc)
+        {
+            o.refresh_ms = std::max(100, std::atoi(argv[++i]));
+        }
+        else if (a == "--no-color")
+        {
+            o.no_color = true;
+        }
+        else if (a == "--sort" && i + 1 < argc)
+        {
+            o.sort = argv[++i];
+            if (!parse_process_order(o.sort, o.sort_keys))
+            {
+                o.sort = "cpu";
+                o.sort_keys = {ProcessSortKey::Cpu};
+            }
+        }
+        else if (a == "--top" && i + 1 < argc)
+        {
+            o.top = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (a == "--collector-threads" && i + 1 < argc)
+        {
+            int threads = 0;
+            if (!procfs::parse(std::string_view(argv[++i]), threads) || threads < 1)
+            {
+                std::cerr << "buzz: --collector-threads: expected a positive number, got '" << argv[i] << "'\n";
+                std::exit(2);
+            }
+            o.collector_threads = std::min(threads, MAX_COLLECTOR_THREADS);
+        }
+        else if (a == "--process-backend" && i + 1 < argc)
+        {
+            std::string b = argv[++i];
+            if (b == "proc")
+                o.process_backend = ProcessBackend::Proc;
+            else if (b == "netlink")
+                o.process_backend = ProcessBackend::Netlink;
+            else
+            {
+                std::cerr << "buzz: --process-backend: expected proc or netlink, got '" << b << "'\n";
+                std::exit(2);
+            }
+        }
+        else if (a == "--collect" && i + 1 < argc)
+        {
+            std::string err;
+            if (!parse_collectors(argv[++i], o.collectors, &err))
+            {
+                std::cerr << "buzz: --collect: " << err << "\n";
+                std::exit(2);
+            }
+        }
+        else if (a == "--stream")
+        {
+            o.stream = true;
+            if (i + 1 < argc && (argv[i + 1][0] != '-' || argv[i + 1][1] == '\0'))
+                o.stream_path = argv[++i]; // optional; "-" is stdout
+        }
+        else if (a == "--fields" && i + 1 < argc)
+        {
+            std::string err;
+            if (!snapshot::parse_sections(argv[++i], o.fields, &err))
+            {
+                std::cerr << "buzz: --fields: " << err << "\n";
+                std::exit(2);
+            }
+        }
+        else if (a == "--convert" && i + 2 < argc)
+        {
+            o.convert_in = argv[++i];
+            o.convert_out = argv[++i];
+        }
+        else if (a == "--record" && i + 1 < argc)
+        {
+            o.record_dir = argv[++i];
+        }
+        else if (a == "--record-size" && i + 1 < argc)
+        {
+            o.record_bytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i]))) << 20; // MB
+        }
+        else if (a == "--record-info" && i + 1 < argc)
+        {
+            o.record_info = argv[++i];
+        }
+        else if (a == "--replay" && i + 1 < argc)
+        {
+            o.replay_path = argv[++i];
+        }
+        else if (a == "-h" || a == "--help")
+        {
+            usage(argv[0]);
+            std::exit(0);
+        }
     }
+    return o;
 }
 
-// truncate to fit column width
-static inline std::string ellipsize(const std::string &s, size_t maxw)
+// --record-info: what a recording holds, as JSON
+static int record_info(const std::string &dir)
 {
-    if (maxw == 0)
-        return "";
-    if (s.size() <= maxw)
-        return s;
-    if (maxw <= 3)
-        return s.substr(0, maxw);
-    return s.substr(0, maxw - 3) + "...";
+    history::HistoryReader reader;
+    std::string err;
+    std::string path = history::ring_path(dir);
+    if (!reader.open(path, &err))
+    {
+        std::cerr << "buzz: " << err << "\n";
+        return 1;
+    }
+
+    auto when = [](std::int64_t ns)
+    {
+        return snapshot::format_timestamp(std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns))));
+    };
+    nlohmann::json j;
+    j["path"] = path;
+    j["records"] = reader.size();
+    if (reader.size() > 0)
+    {
+        j["first"] = when(reader.entries().front().timestamp_ns);
+        j["last"] = when(reader.entries().back().timestamp_ns);
+        j["first_seq"] = reader.entries().front().seq;
+        j["last_seq"] = reader.entries().back().seq;
+
+        // what retention the ring size buys at the current rate
+        std::uint64_t bytes = 0;
+        std::size_t keyframes = 0;
+        for (const auto &e : reader.entries())
+        {
+            bytes += e.size;
+            keyframes += e.magic != history::DELTA_MAGIC;
+        }
+        j["keyframes"] = keyframes;
+        j["bytes"] = bytes;
+        j["bytes_per_record"] = bytes / reader.size();
+    }
+    std::cout << j.dump(4) << std::endl;
+    return 0;
 }
 
-static int get_terminal_width()
+// rows of the process list left by the search filter, or null when there is none
+static const std::vector<std::uint32_t> *filtered_rows(const SystemSample &sample, const UiState &ui, std::vector<std::uint32_t> &storage)
 {
-    winsize ws{};
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
-        return ws.ws_col;
-    return 120;
+    if (ui.filter.empty())
+        return nullptr;
+    storage = filter_processes(sample.process_table(), ui.filter);
+    return &storage;
 }
 
-static void print_table(const std::string &title, const std::vector<json> &rows, const std::vector<std::string> &preferred_cols = {}, int max_rows = 25)
+// compose the whole frame off-screen; only changed cells reach the terminal
+static void draw(Screen &scr, Layout &layout, const SystemSample &sample, const ProcessTracker *tracker, const Replay *replay,
+                 const Options &opts, UiState &ui)
 {
-    std::cout << theme.on(theme.enabled, theme.title) << title << theme.on(theme.enabled, theme.reset) << "\n";
-    if (rows.empty())
+    // summary
+    std::vector<std::pair<std::string, std::string>> kv;
+    kv.push_back({"CPU", fmt_pct(sample.cpu_usage)});
     {
-        std::cout << "  (no data)\n";
-        return;
+        std::string ghz;
+        render::append_fixed(ghz, 0.001 * sample.cpu_frequency, 2); // MHz -> GHz
+        kv.push_back({"CPU Freq (GHz)", ghz});
     }
+    kv.push_back({"Procs Running", std::to_string(sample.running_processes)});
+    kv.push_back({"Cores", std::to_string(sample.logical_processors)});
+    if (sample.topology)
+        kv.push_back({"Topology", std::to_string(sample.topology->sockets) + " socket(s), " +
+                                      std::to_string(sample.topology->physical_cores) + " core(s), " +
+                                      std::to_string(sample.topology->threads_per_core) + " thread(s)/core, " +
+                                      std::to_string(sample.topology->numa_nodes) + " NUMA node(s)"});
+
+    kv.push_back({"Memory Used", fmt_pct(sample.memory_usage)});
+    kv.push_back({"Swap Free", human_bytes_total(1024.0 * sample.memory.swap_free)});
+    kv.push_back({"Swap Total", human_bytes_total(1024.0 * sample.memory.swap_total)});
+    if (sample.memory.mem_total > 0)
+        kv.push_back({"Mem Total", human_bytes_total(1024.0 * sample.memory.mem_total)});
+    if (sample.memory.mem_available > 0)
+        kv.push_back({"Mem Avail", human_bytes_total(1024.0 * sample.memory.mem_available)});
+    kv.push_back({"Buffers/Cached", human_bytes_total(1024.0 * sample.memory.buffers) + " / " + human_bytes_total(1024.0 * sample.memory.cached)});
+    kv.push_back({"Dirty/Writeback", human_bytes_total(1024.0 * sample.memory.dirty) + " / " + human_bytes_total(1024.0 * sample.memory.writeback)});
 
-    // flatten rows
-    std::vector<std::map<std::string, std::string>> flat;
-    flat.reserve(rows.size());
-    std::set<std::string> allcols;
-    for (const auto &r : rows)
+    kv.push_back({"Battery", sample.battery.status + " (" + std::to_string(sample.battery.current_charge) + "%)"});
+    kv.push_back({"Refresh", std::to_string(opts.refresh_ms) + " ms"});
+    {
+        // what the previous frame cost on the terminal side
+        std::string frame;
+        render::append_int(frame, static_cast<long long>(scr.last_frame().bytes));
+        frame += " B in ";
+        render::append_int(frame, static_cast<long long>(scr.last_frame().writes));
+        frame += " write(s)";
+        kv.push_back({"Last Frame", frame});
+    }
+    if (tracker && opts.process_backend == ProcessBackend::Netlink)
     {
-        std::map<std::string, std::string> f;
-        flatten_json(r, "", f);
-        flat.push_back(std::move(f));
-        for (auto &kv : flat.back())
-            allcols.insert(kv.first);
+        kv.push_back({"Proc Source", tracker->backend() == ProcessBackend::Netlink
+                                         ? std::string("netlink")
+                                         : "/proc (netlink unavailable: " + tracker->backend_error() + ")"});
     }
+    if (replay)
+    {
+        std::string where = snapshot::format_timestamp(sample.timestamp);
+        where += replay->playing() ? "  playing x" : "  paused x";
+        render::append_int(where, replay->speed());
+        where += "  frame ";
+        render::append_int(where, static_cast<long long>(replay->index() + 1));
+        where += '/';
+        render::append_int(where, static_cast<long long>(replay->size()));
+        kv.push_back({"Replay", where});
+    }
+
+    // fit the panels to the terminal; --top caps the process viewport
+    const PanelPlan &plan = layout.plan(kv.size(), static_cast<size_t>(opts.top), sample.per_core_usage.size(),
+                                        sample.network.size(), sample.disks.size());
+    ui.page = plan.process_rows;
+
+    // processes: only the rows in the viewport are ranked in full and formatted
+    std::vector<std::uint32_t> matches;
+    const std::vector<std::uint32_t> *rows = filtered_rows(sample, ui, matches);
+    size_t total = rows ? rows->size() : sample.process_table().size();
+    ui.scroll = std::min(ui.scroll, total > ui.page ? total - ui.page : 0); // the list may have shrunk
+    std::vector<std::uint32_t> order = rank_window(sample.process_table(), opts.sort_keys, ui.scroll, ui.page, rows);
 
-    // determine column order
-    // if preference exists, print that
-    // if not, print alphabetically
-    std::vector<std::string> cols;
-    std::set<std::string> used;
-    for (const auto &c : preferred_cols)
+    // render w color!
+    scr.resize(layout.rows(), layout.cols());
+    scr.clear();
+
+    // title
+    scr.print("buzz: a lightweight resource monitor", Screen::Ok);
+    scr.print("  ");
+    scr.print("(configure with --refresh <ms> --sort <cpu|mem|...> --top <N>)", Screen::Dim);
+    scr.print("\n");
+    print_line(scr);
+
+    print_kv(scr, kv);
+    print_line(scr);
+
+    auto panel = [&](const render::Table &t, size_t max_rows)
     {
-        if (allcols.count(c))
+        print_table(scr, t, layout.widths(*t.columns), max_rows);
+        print_line(scr);
+    };
+    panel(process_table(sample, order, total, opts, ui), ui.page);
+    if (plan.show_cores)
+        panel(core_table(sample), plan.core_rows);
+    if (plan.show_network)
+        panel(network_table(sample), plan.network_rows);
+    if (plan.show_disks)
+        panel(disk_table(sample), plan.disk_rows);
+
+    // status and prompt are pinned to the bottom rows, over whatever body ran that far
+    auto bottom_row = [&](int row)
+    {
+        scr.move(row, 0);
+        scr.fill(' ', scr.cols());
+        scr.move(row, 0);
+    };
+    if (!ui.status.empty())
+    {
+        bottom_row(scr.rows() - 2);
+        scr.print(ui.status, ui.status_style);
+    }
+    bottom_row(scr.rows() - 1);
+    switch (ui.prompt)
+    {
+    case UiState::Prompt::Kill:
+        scr.print("Kill", Screen::Warn);
+        scr.print(" <pid> [--sigkill|--sigterm|--signal <num>], Enter to send, Esc to cancel: ");
+        break;
+    case UiState::Prompt::Pid:
+        scr.print("Go to PID", Screen::Warn);
+        scr.print(": ");
+        break;
+    case UiState::Prompt::Search:
+        scr.print("Search", Screen::Warn);
+        scr.print(" process names (empty shows all): ");
+        break;
+    case UiState::Prompt::Seek:
+        scr.print("Seek", Screen::Warn);
+        scr.print(" to HH:MM[:SS] (UTC) or +/-seconds: ");
+        break;
+    case UiState::Prompt::None:
+        if (replay)
         {
-            cols.push_back(c);
-            used.insert(c);
+            scr.print("Replay", Screen::Warn);
+            scr.print(" [space play/pause | left/right -/+10s | [ ] step | +/- speed | t seek] ");
         }
+        scr.print("Keys", Screen::Warn);
+        scr.print(" [q quit | d/b save json/binary | s sort (");
+        scr.print(process_sort_key_name(opts.sort_keys.front()));
+        scr.print(") | k kill | / search | g go to pid | arrows/PgUp/PgDn/Home/End scroll]");
+        break;
     }
-    for (const auto &c : allcols)
+    if (ui.prompt != UiState::Prompt::None)
     {
-        if (!used.count(c))
-            cols.push_back(c);
+        scr.print(ui.input);
+        scr.print("_");
     }
+    scr.flush();
+}
 
-    // find max column width & assign that as all widths
-    // clamp widths and adapt to terminal width
-    std::vector<size_t> widths(cols.size(), 0);
-    for (size_t i = 0; i < cols.size(); ++i)
-    {
-        widths[i] = std::max(widths[i], cols[i].size());
-    }
-    int rcount = std::min<int>((int)flat.size(), max_rows);
-    for (int r = 0; r < rcount; ++r)
+// run a finished kill prompt: <pid> [--sigkill|--sigterm|--signal <num>]
+static void run_kill(const std::string &line, UiState &ui)
+{
+    std::istringstream iss(line);
+    int pid = 0;
+    iss >> pid;
+    int sig = SIGTERM;
+    std::string opt;
+    while (iss >> opt)
     {
-        for (size_t i = 0; i < cols.size(); ++i)
+        if (opt == "--sigkill" || opt == "--force")
+            sig = SIGKILL;
+        else if (opt == "--sigterm")
+            sig = SIGTERM;
+        else if (opt == "--signal")
         {
-            auto it = flat[r].find(cols[i]);
-            if (it != flat[r].end())
-                widths[i] = std::max(widths[i], it->second.size());
+            int s = 0;
+            if (iss >> s)
+                sig = s;
         }
     }
 
-    // clamp individual column widths
-    const size_t MAX_COL_WIDTH = 40;
-    const size_t MIN_COL_WIDTH = 6;
-    for (size_t i = 0; i < widths.size(); ++i)
+    if (pid <= 1)
     {
-        if (widths[i] > MAX_COL_WIDTH)
-            widths[i] = MAX_COL_WIDTH;
-        if (widths[i] < MIN_COL_WIDTH)
-            widths[i] = std::max(widths[i], MIN_COL_WIDTH);
+        ui.status = "Refusing to signal PID <= 1";
+        ui.status_style = Screen::Warn;
+        return;
     }
+    std::string err;
+    bool ok = kill_process(pid, sig, &err);
+    ui.status = std::string(ok ? "OK" : "ERR") + ": kill(" + std::to_string(pid) + ", " + std::to_string(sig) + ") " + (ok ? "success" : err);
+    ui.status_style = ok ? Screen::Ok : Screen::Err;
+}
 
-    // drop columns to fit terminal width if necessary
-    int termw = get_terminal_width();
-    int padding = 2;         // left margin spaces before the table
-    int inter_col_space = 2; // spaces between columns
-    auto required_width = [&](size_t count) -> size_t
+// save the sample on screen, rather than sampling again for a second
+static void save_snapshot(const SystemSample &sample, UiState &ui, bool binary)
+{
+    std::string path = snapshot::default_filename(binary ? ".bin" : ".json");
+    std::string err;
+    bool ok = binary ? snapshot::save_binary(sample, path, &err)
+                     : snapshot::save_to_file(snapshot::to_json(sample), path, &err);
+    std::string display_path;
+    try
     {
-        if (count == 0)
-            return 0;
-        size_t sum = 0;
-        for (size_t i = 0; i < count; ++i)
-            sum += widths[i];
-        sum += (count - 1) * inter_col_space;
-        sum += padding; // left margin
-        return sum;
-    };
+        display_path = (std::filesystem::current_path() / path).string();
+    }
+    catch (...)
+    {
+        display_path = path; // fallback
+    }
+    ui.status = ok ? "Saved snapshot: " + display_path : "Snapshot failed: " + err;
+    ui.status_style = ok ? Screen::Ok : Screen::Err;
+}
 
-    // keep as many columns as will fit
-    size_t keep = cols.size();
-    while (keep > 0 && (int)required_width(keep) > std::max(40, termw - 2))
-        --keep;
-    if (keep < cols.size())
+// scroll so pid is in the middle of the viewport and highlight it
+static void jump_to_pid(const std::string &line, const SystemSample &sample, const Options &opts, UiState &ui)
+{
+    int pid = std::atoi(line.c_str());
+    size_t row = find_process(sample.process_table(), pid);
+    if (row == sample.process_table().size())
     {
-        cols.resize(keep);
-        widths.resize(keep);
+        ui.status = "No process with PID " + line;
+        ui.status_style = Screen::Warn;
+        return;
     }
 
-    // header is left-aligned, in cyan, 2 spaces per column
-    std::cout << "  ";
-    for (size_t i = 0; i < cols.size(); ++i)
+    // a pid hidden by the search is still shown: drop the filter
+    std::vector<std::uint32_t> matches;
+    const std::vector<std::uint32_t> *rows = filtered_rows(sample, ui, matches);
+    if (rows && std::find(rows->begin(), rows->end(), static_cast<std::uint32_t>(row)) == rows->end())
     {
-        std::string head = ellipsize(cols[i], widths[i]);
-        std::cout << theme.on(theme.enabled, theme.header) << std::setw((int)widths[i]) << std::left << head << theme.on(theme.enabled, theme.reset);
-        if (i + 1 < cols.size())
-            std::cout << "  ";
+        ui.filter.clear();
+        rows = nullptr;
     }
-    std::cout << "\n";
-    print_line();
 
-    // prints upto max rows for data rows
-    // left aligned
-    for (int r = 0; r < rcount; ++r)
+    size_t rank = process_rank(sample.process_table(), opts.sort_keys, static_cast<std::uint32_t>(row), rows);
+    size_t half = ui.page / 2;
+    ui.scroll = rank > half ? rank - half : 0;
+    ui.selected_pid = pid;
+    ui.status.clear();
+}
+
+// replay seek prompt: "+30"/"-90" seconds from the current frame, or a UTC time
+// of day on the current frame's date
+static void seek_replay(const std::string &line, Replay *replay, UiState &ui)
+{
+    if (!replay || line.empty())
+        return;
+    constexpr std::int64_t NS = 1000000000;
+    std::int64_t target;
+    if (line[0] == '+' || line[0] == '-')
+    {
+        // unsigned, so "+-5" is rejected rather than read as -5
+        std::uint32_t seconds = 0;
+        if (!procfs::parse(std::string_view(line).substr(1), seconds))
+        {
+            ui.status = "Seek: expected HH:MM[:SS] or +/-seconds";
+            ui.status_style = Screen::Err;
+            return;
+        }
+        std::int64_t offset = static_cast<std::int64_t>(seconds) * NS;
+        target = replay->position_ns() + (line[0] == '-' ? -offset : offset);
+    }
+    else
     {
-        std::cout << "  ";
-        for (size_t i = 0; i < cols.size(); ++i)
+        int h = 0, m = 0, sec = 0;
+        if (std::sscanf(line.c_str(), "%d:%d:%d", &h, &m, &sec) < 2)
         {
-            auto it = flat[r].find(cols[i]);
-            std::string val = (it != flat[r].end()) ? it->second : "";
-            val = ellipsize(val, widths[i]);
-            std::cout << std::setw((int)widths[i]) << std::left << val;
-            if (i + 1 < cols.size())
-                std::cout << "  ";
+            ui.status = "Seek: expected HH:MM[:SS] or +/-seconds";
+            ui.status_style = Screen::Err;
+            return;
         }
-        std::cout << "\n";
+        std::int64_t midnight = replay->position_ns() / (86400 * NS) * (86400 * NS);
+        target = midnight + (h * 3600LL + m * 60LL + sec) * NS;
     }
+    replay->seek(target);
+    ui.status.clear();
 }
 
-static void usage(const char *argv0)
+// playback keys; false for keys that aren't about replay
+static bool handle_replay_key(const Key &key, Replay &replay, UiState &ui)
 {
-    std::cout << "Usage: " << argv0 << " [--refresh <ms>] [--no-color] [--sort cpu|mem] [--top N]\n";
+    constexpr std::int64_t STEP = 10LL * 1000000000; // left/right
+    auto now = std::chrono::steady_clock::now();
+    if (key.code == Key::Left || key.code == Key::Right)
+    {
+        replay.advance(now);
+        replay.seek(replay.position_ns() + (key.code == Key::Left ? -STEP : STEP));
+        return true;
+    }
+    if (key.code != Key::Char)
+        return false;
+    switch (key.ch)
+    {
+    case ' ':
+        replay.toggle(now);
+        return true;
+    case '[':
+    case ']':
+        replay.advance(now);
+        replay.step(key.ch == '[' ? -1 : 1);
+        return true;
+    case '+':
+    case '-':
+        replay.set_speed(key.ch == '+' ? replay.speed() * 2 : replay.speed() / 2, now);
+        return true;
+    case 't':
+        ui.prompt = UiState::Prompt::Seek;
+        ui.input.clear();
+        return true;
+    default:
+        return false;
+    }
 }
 
-static Options parse_opts(int argc, char **argv)
+// returns false when the key asks to quit
+static bool handle_key(const Key &key, Options &opts, UiState &ui, const SystemSample &sample, Replay *replay)
 {
-    Options o; // initialize w default options
-    for (int i = 1; i < argc; ++i)
+    if (ui.prompt != UiState::Prompt::None)
     {
-        std::string a = argv[i];
-        if (a == "--refresh" && i + 1 < argc)
+        if (key.code == Key::Char)
+            ui.input += key.ch;
+        else if (key.code == Key::Backspace && !ui.input.empty())
+            ui.input.pop_back();
+        else if (key.code == Key::Escape)
+            ui.prompt = UiState::Prompt::None;
+        else if (key.code == Key::Enter)
         {
-            o.refresh_ms = std::max(250, std::atoi(argv[++i]));
+            UiState::Prompt prompt = ui.prompt;
+            ui.prompt = UiState::Prompt::None;
+            if (prompt == UiState::Prompt::Kill)
+                run_kill(ui.input, ui);
+            else if (prompt == UiState::Prompt::Seek)
+                seek_replay(ui.input, replay, ui);
+            else if (prompt == UiState::Prompt::Pid)
+                jump_to_pid(ui.input, sample, opts, ui);
+            else
+            {
+                ui.filter = ui.input;
+                ui.scroll = 0;
+            }
         }
-        else if (a == "--no-color")
+        return true;
+    }
+
+    if (replay && handle_replay_key(key, *replay, ui))
+        return true;
+
+    // scrolling; draw() clamps the result to the list
+    size_t page = ui.page;
+    switch (key.code)
+    {
+    case Key::Escape:
+        ui.status.clear();
+        ui.filter.clear();
+        ui.selected_pid = 0;
+        return true;
+    case Key::Up:
+        ui.scroll -= std::min<size_t>(ui.scroll, 1);
+        return true;
+    case Key::Down:
+        ui.scroll += 1;
+        return true;
+    case Key::PageUp:
+        ui.scroll -= std::min(ui.scroll, page);
+        return true;
+    case Key::PageDown:
+        ui.scroll += page;
+        return true;
+    case Key::Home:
+        ui.scroll = 0;
+        return true;
+    case Key::End:
+        ui.scroll = SIZE_MAX / 2;
+        return true;
+    case Key::Char:
+        break;
+    default:
+        return true;
+    }
+
+    switch (key.ch)
+    {
+    case 'q':
+    case 'Q':
+        return false;
+    case 'd':
+    case 'b':
+        save_snapshot(sample, ui, key.ch == 'b');
+        break;
+    case 's':
+    {
+        // cycle the primary key through cpu, mem, threads, time, pid, name
+        int next = (static_cast<int>(opts.sort_keys.front()) + 1) % (static_cast<int>(ProcessSortKey::Name) + 1);
+        opts.sort_keys = {static_cast<ProcessSortKey>(next)};
+        break;
+    }
+    case 'k':
+        if (replay)
         {
-            o.no_color = true;
+            ui.status = "Kill is not available in replay";
+            ui.status_style = Screen::Warn;
+            break;
         }
-        else if (a == "--sort" && i + 1 < argc)
+        ui.prompt = UiState::Prompt::Kill;
+        ui.input.clear();
+        break;
+    case 'g':
+        ui.prompt = UiState::Prompt::Pid;
+        ui.input.clear();
+        break;
+    case '/':
+        ui.prompt = UiState::Prompt::Search;
+        ui.input = ui.filter;
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    auto opts = parse_opts(argc, argv);
+    if (!opts.convert_in.empty())
+    {
+        std::string err;
+        if (!snapshot::convert_file(opts.convert_in, opts.convert_out, &err))
         {
-            o.sort = argv[++i];
-            if (o.sort != "cpu" && o.sort != "mem")
-                o.sort = "cpu";
+            std::cerr << "buzz: " << err << "\n";
+            return 1;
         }
-        else if (a == "--top" && i + 1 < argc)
+        return 0;
+    }
+    if (!opts.record_info.empty())
+        return record_info(opts.record_info);
+    if (!opts.record_dir.empty())
+        return history::record(opts.record_dir, opts.record_bytes, opts.collector_threads, opts.process_backend,
+                               std::chrono::milliseconds(opts.refresh_ms), opts.collectors);
+    if (opts.stream)
+    {
+        StreamOptions so;
+        so.path = opts.stream_path;
+        so.sections = opts.fields;
+        so.interval = std::chrono::milliseconds(opts.refresh_ms);
+        so.collector_threads = opts.collector_threads;
+        so.process_backend = opts.process_backend;
+        so.collectors = opts.collectors;
+        return stream::run(so);
+    }
+
+    // signals are read from a signalfd; block them before the collector threads
+    // start so none of them is delivered to a worker
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGWINCH);
+    sigprocmask(SIG_BLOCK, &mask, nullptr);
+    int sig_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+
+    if (sig_fd < 0)
+    {
+        std::cerr << "buzz: signalfd: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    // open the recording before taking over the terminal, so errors stay readable
+    std::unique_ptr<Replay> replay;
+    if (!opts.replay_path.empty())
+    {
+        std::string err;
+        replay = std::make_unique<Replay>();
+        if (!replay->open(opts.replay_path, &err))
         {
-            o.top = std::max(1, std::atoi(argv[++i]));
+            std::cerr << "buzz: " << err << "\n";
+            return 1;
         }
-        else if (a == "-h" || a == "--help")
+    }
+
+    // collection runs on its own thread and publishes immutable samples; this
+    // thread only draws and reads keys, so a slow /proc scan never stalls input.
+    // a replay feeds recorded samples instead and wakes poll() when one is due
+    std::unique_ptr<SamplerThread> collector;
+    if (!replay)
+    {
+        collector = std::make_unique<SamplerThread>(opts.collector_threads, opts.process_backend,
+                                                    std::chrono::milliseconds(opts.refresh_ms), opts.collectors);
+        if (!collector->ok())
         {
-            usage(argv[0]);
-            std::exit(0);
+            std::cerr << "buzz: " << collector->error() << "\n";
+            return 1;
         }
     }
-    return o;
-}
-
-int main(int argc, char **argv)
-{
-    auto opts = parse_opts(argc, argv);
-    theme.enabled = !opts.no_color;
 
-    std::signal(SIGINT, on_signal);
-    std::signal(SIGTERM, on_signal);
-    std::cout << ansi::hide_cursor;
+    RawTerminal raw(STDIN_FILENO);
+    std::cout << ansi::clear_scrollback << ansi::hide_cursor << std::flush;
+    Screen scr(STDOUT_FILENO, !opts.no_color);
+    Layout layout;
+    layout.update();
+    UiState ui;
+    KeyDecoder decoder;
+    std::vector<Key> keys;
+    std::shared_ptr<const SystemSample> sample; // what is on screen
 
+    bool running = true;
+    bool need_draw = false;
     while (running)
     {
-        auto t0 = std::chrono::steady_clock::now();
-
-        // CPU summary
-        json cpu_json;
-        cpu_json["cpu_usage"] = get_cpu_usage();
-        cpu_json["cpu_name"] = get_cpu_name();
-        cpu_json["running_processes"] = get_running_processes();
-        cpu_json["cpu_frequency"] = get_cpu_frequency();
-        cpu_json["no_of_logical_processors"] = get_no_logical_processors();
-
-        // memory summary
-        json mem_json;
-        mem_json["memory_usage"] = get_memory_usage();
-        mem_json["cached_memory"] = get_mem_value("Cached:");
-        mem_json["free_swappable_memory"] = get_mem_value("SwapFree:");
-        mem_json["total_swappable_memory"] = get_mem_value("SwapTotal:");
-        // additional totals in bytes if available via /proc/meminfo keys
-        // We reuse get_mem_value which returns KiB for matching labels.
-        long mem_total_kib = get_mem_value("MemTotal:");
-        long mem_free_kib = get_mem_value("MemAvailable:");
-        if (mem_total_kib > 0)
-            mem_json["total_memory_kib"] = mem_total_kib;
-        if (mem_free_kib > 0)
-            mem_json["available_memory_kib"] = mem_free_kib;
-
-        // battery stats
-        auto b = get_battery_info();
-        json batt_json = battery_to_json(b);
-
-        // processes
-        auto processes = get_all_processes();
-        std::vector<json> proc_rows;
-        proc_rows.reserve(processes.size());
-        for (const auto &p : processes)
-            proc_rows.push_back(process_to_json(p));
-
-        // sort processes
-        auto get_double = [](const json &r, const std::string &key, double defv = 0.0)
-        {
-            const json *cur = &r;
-            std::stringstream ss(key);
-            std::string part;
-            while (std::getline(ss, part, '.'))
+        if (replay)
+        {
+            std::string err;
+            replay->advance(std::chrono::steady_clock::now());
+            std::shared_ptr<const SystemSample> frame = replay->current(&err);
+            if (!frame)
             {
-                if (!cur->is_object() || !cur->contains(part))
-                    return defv;
-                cur = &((*cur)[part]);
+                ui.status = "Replay: " + err;
+                ui.status_style = Screen::Err;
+                need_draw = true;
             }
-            if (cur->is_number_float())
-                return cur->get<double>();
-            if (cur->is_number_integer())
-                return static_cast<double>(cur->get<long long>());
-            if (cur->is_number_unsigned())
-                return static_cast<double>(cur->get<unsigned long long>());
-            return defv;
-        };
-        std::string sort_key = (opts.sort == "mem") ? "memory.memory_percent" : "cpu.cpu_usage";
-        std::sort(proc_rows.begin(), proc_rows.end(), [&](const json &a, const json &b)
-                  { return get_double(a, sort_key) > get_double(b, sort_key); });
-
-        // network
-        auto net_ifaces = get_network_rates();
-        std::vector<json> net_rows;
-        net_rows.reserve(net_ifaces.size());
-        for (const auto &n : net_ifaces)
-            net_rows.push_back(network_to_json(n));
-
-        // disks
-        auto disks = get_disk_stats();
-        std::vector<json> disk_rows;
-        disk_rows.reserve(disks.size());
-        for (const auto &d : disks)
-            disk_rows.push_back(disk_to_json(d));
-
-        // render w color!
-        std::cout << ansi::clear << ansi::home << std::flush;
-
-        // title
-        std::cout << theme.on(theme.enabled, theme.ok) << std::string("buzz: a lightweight resource monitor")
-                  << theme.on(theme.enabled, theme.reset) << "  "
-                  << theme.on(theme.enabled, theme.dim) << "(configure with --refresh <ms> --sort <cpu|mem> --top <N>)"
-                  << theme.on(theme.enabled, theme.reset) << "\n";
-        print_line();
-
-        // summary
-        std::vector<std::pair<std::string, std::string>> kv;
-        kv.push_back({"CPU", fmt_pct(cpu_json["cpu_usage"].get<double>())});
-        kv.push_back({"CPU Freq (GHz)", [&]()
-                      {
-                          std::ostringstream s;
-                          s << std::fixed << std::setprecision(2) << cpu_json["cpu_frequency"].get<double>();
-                          return s.str();
-                      }()});
-        kv.push_back({"Procs Running", std::to_string((long long)cpu_json["running_processes"].get<long long>())});
-        kv.push_back({"Cores", std::to_string(cpu_json["no_of_logical_processors"].get<int>())});
-
-        kv.push_back({"Memory Used", fmt_pct(mem_json["memory_usage"].get<double>())});
-        kv.push_back({"Swap Free", human_bytes_total(1024.0 * mem_json["free_swappable_memory"].get<long>())});
-        kv.push_back({"Swap Total", human_bytes_total(1024.0 * mem_json["total_swappable_memory"].get<long>())});
-        if (mem_json.contains("total_memory_kib"))
-            kv.push_back({"Mem Total", human_bytes_total(1024.0 * mem_json["total_memory_kib"].get<long>())});
-        if (mem_json.contains("available_memory_kib"))
-            kv.push_back({"Mem Avail", human_bytes_total(1024.0 * mem_json["available_memory_kib"].get<long>())});
-
-        kv.push_back({"Battery", batt_json["status"].get<std::string>() + " (" + std::to_string(batt_json["current_capacity"].get<int>()) + "%)"});
-        kv.push_back({"Refresh", std::to_string(opts.refresh_ms) + " ms"});
-
-        print_kv(kv);
-        print_line();
-
-        // processes table (top N)
-        {
-            // Prefer showing the sort-related columns earlier. When sorting by memory,
-            // place memory columns before CPU columns so they are less likely to be
-            // trimmed on narrow terminals.
-            std::vector<std::string> pref;
-            if (opts.sort == "mem")
+            else if (frame != sample)
             {
-                pref = {
-                    "process_id", "process_name", "user", "status", "threads", "type",
-                    // memory-first when sorting by memory
-                    "memory.memory_percent", "memory.memory_usage_kb",
-                    // then cpu
-                    "cpu.cpu_usage", "cpu.cpu_time"};
+                sample = std::move(frame);
+                need_draw = true;
             }
-            else
-            {
-                // default (CPU-first)
-                pref = {
-                    "process_id", "process_name", "user", "status", "threads", "type",
-                    "cpu.cpu_usage", "cpu.cpu_time", "memory.memory_percent", "memory.memory_usage_kb"};
-            }
-            print_table(std::string("Processes (sorted by ") + (opts.sort == "mem" ? "Memory%" : "CPU%") + ", top " + std::to_string(opts.top) + ")",
-                        proc_rows, pref, opts.top);
+            need_draw = need_draw || replay->playing(); // the position line moves
         }
-        print_line();
 
-        // per-core CPU table
+        if (need_draw && sample)
         {
-            std::vector<double> per_core = get_per_core_usage();
-            std::vector<json> core_rows;
-            core_rows.reserve(per_core.size());
-            for (size_t i = 0; i < per_core.size(); ++i)
-            {
-                json row;
-                row["core"] = (int)i;
-                row["usage_percent"] = per_core[i];
-                core_rows.push_back(row);
-            }
-            print_table(std::string("CPU Cores"), core_rows, {"core", "usage_percent"}, 128);
+            draw(scr, layout, *sample, collector ? &collector->process_tracker() : nullptr, replay.get(), opts, ui);
+            need_draw = false;
         }
-        print_line();
 
-        // network table (humanized rates if fields present)
-        // Try to replace numeric rates with human-readable strings if keys look like *_rate or *_bytes
+        // poll skips the negative fd in replay
+        pollfd fds[] = {{STDIN_FILENO, POLLIN, 0}, {collector ? collector->event_fd() : -1, POLLIN, 0}, {sig_fd, POLLIN, 0}};
+        if (poll(fds, 3, replay ? replay->timeout_ms() : -1) < 0)
         {
-            std::vector<json> net_rows_human = net_rows;
-            for (auto &row : net_rows_human)
-            {
-                for (auto it = row.begin(); it != row.end(); ++it)
-                {
-                    const std::string k = it.key();
-                    if ((k.find("rate") != std::string::npos || k.find("bytes") != std::string::npos) && it.value().is_number())
-                    {
-                        double v = it.value().get<double>();
-                        row[k] = human_bytes(v);
-                    }
-                }
-            }
-            print_table(std::string("Network Interfaces"), net_rows_human, {"interface", "download_rate", "upload_rate"});
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (collector && (fds[1].revents & POLLIN))
+        {
+            collector->drain();
+            sample = collector->latest();
+            need_draw = true;
         }
-        print_line();
 
-        // disk table (humanize *_bytes fields)
+        if (fds[2].revents & POLLIN)
         {
-            std::vector<json> disk_rows_human = disk_rows;
-            for (auto &row : disk_rows_human)
+            signalfd_siginfo si;
+            while (read(sig_fd, &si, sizeof(si)) == static_cast<ssize_t>(sizeof(si)))
             {
-                for (auto it = row.begin(); it != row.end(); ++it)
-                {
-                    const std::string k = it.key();
-                    if (k.find("bytes") != std::string::npos && it.value().is_number())
-                    {
-                        double v = it.value().get<double>();
-                        row[k] = human_bytes_total(v);
-                    }
-                    if (k.find("rate") != std::string::npos && it.value().is_number())
-                    {
-                        double v = it.value().get<double>();
-                        row[k] = human_bytes(v);
-                    }
-                }
+                if (si.ssi_signo == SIGWINCH)
+                    need_draw = layout.update() || need_draw; // geometry is only queried here
+                else
+                    running = false;
             }
-            print_table(std::string("Disks"), disk_rows_human);
         }
-        print_line();
 
-        // cmd prompt (non-blocking)
-        std::cout << theme.on(theme.enabled, theme.warn) << "Command" << theme.on(theme.enabled, theme.reset)
-                  << " [q to exit | d to download snapshot | k <pid> [--sigkill|--sigterm|--signal <num>] to kill processes]: " << std::flush;
-
-        // wait while listening for input
-        auto t1 = std::chrono::steady_clock::now();
-        int elapsed_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-        int wait_ms = std::max(0, opts.refresh_ms - elapsed_ms);
-
-        // select() for stdin readiness
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        FD_SET(STDIN_FILENO, &rfds);
-        timeval tv;
-        tv.tv_sec = wait_ms / 1000;
-        tv.tv_usec = (wait_ms % 1000) * 1000;
-
-        int ready = select(STDIN_FILENO + 1, &rfds, nullptr, nullptr, &tv);
-        if (ready > 0 && FD_ISSET(STDIN_FILENO, &rfds))
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR))
         {
-            std::string line;
-            if (std::getline(std::cin, line))
+            char buf[256];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN))
             {
-                // trim
-                auto ltrim = [](std::string &s)
-                { s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char c)
-                                                  { return !std::isspace(c); })); };
-                auto rtrim = [](std::string &s)
-                { s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char c)
-                                       { return !std::isspace(c); })
-                              .base(),
-                          s.end()); };
-                ltrim(line);
-                rtrim(line);
-                if (line == "q" || line == "quit" || line == "exit")
-                {
-                    break;
-                }
-                else if (!line.empty())
-                {
-                    // parse: k <pid> [--sigkill|--sigterm|--signal <num>]
-                    std::istringstream iss(line);
-                    std::string cmd;
-                    iss >> cmd;
-                    if (cmd == "d")
-                    {
-                        auto j = snapshot::make();
-                        std::string path = snapshot::default_filename();
-                        std::string err;
-                        bool ok = snapshot::save_to_file(j, path, &err);
-                        std::string display_path;
-                        try
-                        {
-                            display_path = (std::filesystem::current_path() / path).string();
-                        }
-                        catch (...)
-                        {
-                            display_path = path; // fallback
-                        }
-                        std::cout << "\n"
-                                  << (ok ? theme.on(theme.enabled, theme.ok) : theme.on(theme.enabled, theme.err))
-                                  << (ok ? "Saved snapshot: " : "Snapshot failed: ")
-                                  << theme.on(theme.enabled, theme.reset)
-                                  << (ok ? display_path : err) << "\n";
-                        std::this_thread::sleep_for(std::chrono::milliseconds(900));
-                    }
-                    else if (cmd == "k" || cmd == "kill")
-                    {
-                        int pid = 0;
-                        iss >> pid;
-                        int sig = SIGTERM;
-                        std::string opt;
-                        while (iss >> opt)
-                        {
-                            if (opt == "--sigkill" || opt == "--force")
-                                sig = SIGKILL;
-                            else if (opt == "--sigterm")
-                                sig = SIGTERM;
-                            else if (opt == "--signal")
-                            {
-                                int s = 0;
-                                if (iss >> s)
-                                    sig = s;
-                            }
-                        }
-                        if (pid > 1)
-                        {
-                            std::string err;
-                            bool ok = kill_process(pid, sig, &err);
-                            std::cout << "\n"
-                                      << (ok ? theme.on(theme.enabled, theme.ok) : theme.on(theme.enabled, theme.err))
-                                      << (ok ? "OK" : "ERR") << theme.on(theme.enabled, theme.reset)
-                                      << ": kill(" << pid << ", " << sig << ") "
-                                      << (ok ? "success" : err) << "\n";
-                            std::this_thread::sleep_for(std::chrono::milliseconds(900));
-                        }
-                        else
-                        {
-                            std::cout << "\n"
-                                      << theme.on(theme.enabled, theme.warn) << "Refusing to signal PID <= 1" << theme.on(theme.enabled, theme.reset) << "\n";
-                            std::this_thread::sleep_for(std::chrono::milliseconds(900));
-                        }
-                    }
-                }
+                running = false; // EOF on stdin
+                continue;
             }
-            else
+            keys.clear();
+            decoder.feed(buf, n > 0 ? static_cast<size_t>(n) : 0, keys);
+            for (const Key &key : keys)
             {
-                // EOF on stdin
-                running = false;
+                // keys before the first sample can only quit or open the prompt
+                static const SystemSample empty{};
+                if (!handle_key(key, opts, ui, sample ? *sample : empty, replay.get()))
+                    running = false;
             }
+            need_draw = need_draw || !keys.empty();
         }
     }
 
-    std::cout << ansi::show_cursor << theme.on(theme.enabled, theme.reset);
+    // leave the shell prompt below the last frame
+    scr.move(scr.rows() - 1, scr.cols());
+    scr.flush();
+    std::cout << ansi::reset << ansi::show_cursor << "\n";
+    close(sig_fd);
     return 0;
 }
@@ -0,0 +1,100 @@
+#include "users.hpp"
+
+#include <cerrno>
+#include <mutex>
+#include <vector>
+#include <pwd.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+UserCache::UserCache(std::chrono::seconds ttl) : ttl_(ttl)
+{
+    intern("unknown"); // UNKNOWN_USER
+
+    // editors and useradd replace /etc/passwd by rename, so watch the directory
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ >= 0 && ::inotify_add_watch(inotify_fd_, "/etc", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0)
+    {
+        ::close(inotify_fd_);
+        inotify_fd_ = -1; // ttl alone still bounds staleness
+    }
+}
+
+UserCache::~UserCache()
+{
+    if (inotify_fd_ >= 0)
+        ::close(inotify_fd_);
+}
+
+void UserCache::revalidate()
+{
+    if (inotify_fd_ < 0)
+        return;
+
+    alignas(inotify_event) char buf[4096];
+    bool passwd_changed = false;
+    for (;;)
+    {
+        ssize_t n = ::read(inotify_fd_, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        for (ssize_t off = 0; off < n;)
+        {
+            const auto *ev = reinterpret_cast<const inotify_event *>(buf + off);
+            if (ev->len > 0 && std::string(ev->name) == "passwd")
+                passwd_changed = true;
+            off += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+        }
+    }
+
+    if (passwd_changed)
+        by_uid_.clear();
+}
+
+UserId UserCache::lookup(uid_t uid)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto it = by_uid_.find(uid);
+    if (it != by_uid_.end() && it->second.expires > now)
+        return it->second.id;
+
+    // getpwuid_r: the plain getpwuid result buffer is shared process-wide
+    passwd pwd{};
+    passwd *result = nullptr;
+    std::vector<char> buf(1024);
+    int rc;
+    while ((rc = ::getpwuid_r(uid, &pwd, buf.data(), buf.size(), &result)) == ERANGE)
+        buf.resize(buf.size() * 2);
+
+    UserId id = intern(rc == 0 && result ? std::string(result->pw_name) : "unknown");
+    by_uid_[uid] = {id, now + ttl_};
+    return id;
+}
+
+UserId UserCache::intern(const std::string &name)
+{
+    std::unique_lock<std::shared_mutex> lock(names_mutex_); // only taken on uid cache misses
+    auto it = ids_.find(name);
+    if (it != ids_.end())
+        return it->second;
+
+    UserId id = static_cast<UserId>(names_.size());
+    names_.push_back(name);
+    ids_.emplace(name, id);
+    return id;
+}
+
+const std::string &UserCache::name(UserId id) const
+{
+    static const std::string unknown = "unknown";
+    std::shared_lock<std::shared_mutex> lock(names_mutex_);
+    return id < names_.size() ? names_[id] : unknown;
+}
+
+UserCache &user_cache()
+{
+    static UserCache cache;
+    return cache;
+}
@@ -0,0 +1,84 @@
+#include "worker_pool.hpp"
+
+WorkerPool::WorkerPool(int threads)
+{
+    try
+    {
+        for (int i = 1; i < threads; ++i)
+            threads_.emplace_back(&WorkerPool::loop, this, i);
+    }
+    catch (...)
+    {
+        // the destructor won't run: join the threads already started, or their
+        // std::thread destructors call std::terminate
+        stop();
+        throw;
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &t : threads_)
+        t.join();
+    threads_.clear();
+}
+
+void WorkerPool::run(const std::function<void(int)> &job)
+{
+    if (threads_.empty())
+    {
+        job(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        pending_ = static_cast<int>(threads_.size());
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]
+               { return pending_ == 0; });
+    job_ = nullptr;
+}
+
+void WorkerPool::loop(int index)
+{
+    unsigned long seen = 0;
+    for (;;)
+    {
+        const std::function<void(int)> *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]
+                       { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+            job = job_;
+        }
+
+        (*job)(index);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --pending_;
+        }
+        done_.notify_one();
+    }
+}